@@ -59,23 +59,26 @@ void eTfGroupComponent::paint (Graphics& g)
 //==============================================================================
 
 eTfFreqView::eTfFreqView() :
-    m_synth(nullptr),
-    m_instr(nullptr), 
-    m_processor(nullptr)
+    m_processor(nullptr),
+    m_generation(0)
 {
-    m_voice = new eTfVoice(eFALSE);
 }
 
-eTfFreqView::~eTfFreqView()
+void eTfFreqView::setProcessor(PluginProcessor *processor)
 {
-    eDelete(m_voice);
+    m_processor = processor;
 }
 
-void eTfFreqView::setSynth(PluginProcessor *processor, eTfSynth *synth, eTfInstrument *instr)
+void eTfFreqView::requestUpdate()
 {
-    m_processor = processor;
-    m_synth = synth;
-    m_instr = instr;
+    if (m_processor != nullptr)
+        m_processor->requestWaveformPreview();
+}
+
+void eTfFreqView::repaintIfChanged()
+{
+    if (m_processor != nullptr && m_processor->getWaveformPreview().generation != m_generation)
+        repaint();
 }
 
 void eTfFreqView::paint (Graphics& g)
@@ -105,31 +108,12 @@ void eTfFreqView::paint (Graphics& g)
                                        false));
     g.fillRect(0, getHeight()/2, getWidth(), getHeight()/2);
 
-    if (m_synth != nullptr && m_instr != nullptr)
+    if (m_processor != nullptr)
     {
-        g.setColour(Colours::white);
-
-        // lock the synth and copy the current voice data
-        // -----------------------------------------------------------
-        m_processor->getSynthCriticalSection().enter();
-
-        if (m_instr->latestTriggeredVoice)
-        {   // note: m_voice is fully owned by the editor
-            eTfVoice *voice = m_instr->latestTriggeredVoice;
-            m_voice->modMatrix = voice->modMatrix;
-            m_voice->generator.modulation = voice->generator.modulation;
-        }
-
-        // calculate the waveform
+        // only draws what the audio thread rendered last
         // -----------------------------------------------------------
-        eTfVoiceReset(*m_voice);
-        eTfGeneratorUpdate(*m_synth, *m_instr, *m_voice, m_voice->generator, 1.0f);
-        eF32 *freqTable = m_voice->generator.freqTable;
-
-        if (eTfGeneratorModulate(*m_synth, *m_instr, *m_voice, m_voice->generator))
-            freqTable = m_voice->generator.freqModTable;
-        
-        m_processor->getSynthCriticalSection().exit();
+        const PluginProcessor::WaveformPreview &preview = m_processor->getWaveformPreview();
+        m_generation = preview.generation;
 
         eF32 next_sep = 0.1f;
         for (eU32 x=3; x<viewWidth; x++)
@@ -143,7 +127,7 @@ void eTfFreqView::paint (Graphics& g)
             }
 
             eU32 offset = (eU32)(pos * TF_IFFT_FRAMESIZE);
-            eF32 value = freqTable[offset];
+            eF32 value = preview.spectrum[offset];
 
             if (x % 2 == 0)
                 g.setColour(displayColour1);
@@ -156,10 +140,7 @@ void eTfFreqView::paint (Graphics& g)
             g.fillRect(x, halfViewHeight - v + 2, 1, v+1);
         }
 
-        eTfGeneratorFft(*m_synth, IFFT, TF_IFFT_FRAMESIZE, freqTable);
-        eTfGeneratorNormalize(freqTable, TF_IFFT_FRAMESIZE);
-
-        eF32 drive = m_instr->params[TF_GEN_DRIVE];
+        eF32 drive = preview.drive;
         drive *= 32.0f;
         drive += 1.0f;
 
@@ -170,7 +151,7 @@ void eTfFreqView::paint (Graphics& g)
             eF32 pos = (eF32)x / viewWidth;
 
             eU32 offset = (eU32)(pos * TF_IFFT_FRAMESIZE);
-            eF32 value = freqTable[offset*2];
+            eF32 value = preview.waveform[offset];
             eF32 valueDrv = value * drive;
 
             value = eClamp<eF32>(-1.0f, value, 1.0f);
@@ -246,7 +227,8 @@ PluginEditor::PluginEditor (PluginProcessor* ownerFilter, eTfSynth *synth) :
     m_imgShapeSquare(Image::ARGB, PIXWIDTH, PIXHEIGHT, true),
     m_imgShapeNoise(Image::ARGB, PIXWIDTH, PIXHEIGHT, true),
     m_midiKeyboard(ownerFilter->keyboardState, MidiKeyboardComponent::horizontalKeyboard),
-    m_meter(*ownerFilter, 2, 0)
+    m_meter(*ownerFilter, 2, 0),
+    m_refreshAll(true)
 {
 	
 	setLookAndFeel(PluginLookAndFeel::getInstance());
@@ -275,10 +257,17 @@ PluginEditor::PluginEditor (PluginProcessor* ownerFilter, eTfSynth *synth) :
     _addTextToggleButton(this, m_btnAnimationsOn, "Animations on", "", 10, 704, 100, 20);
     _addTextToggleButton(this, m_btnFastAnimations, "Fast animations", "", 120, 704, 100, 20);
     _addTextToggleButton(this, m_btnMovingWaveforms, "Moving waveforms", "", 230, 704, 100, 20);
+    _addTextToggleButton(this, m_btnPipelinedFx, "Pipelined effects", "", 340, 704, 100, 20);
+    _addTextToggleButton(this, m_btnMultiTimbral, "Multi-timbral", "", 450, 704, 100, 20);
     
     m_btnAnimationsOn.setToggleState(_configAreAnimationsOn(), dontSendNotification);
     m_btnFastAnimations.setToggleState(_configAreAnimationsFast(), dontSendNotification);
     m_btnMovingWaveforms.setToggleState(_configAreWaveformsMoving(), dontSendNotification);
+    m_btnPipelinedFx.setToggleState(getProcessor()->isPipelinedEffects(), dontSendNotification);
+    m_btnMultiTimbral.setToggleState(getProcessor()->isMultiTimbral(), dontSendNotification);
+
+    _addTextButton(this, m_btnBankImport, "Import bank", 700, 704, 90, 20);
+    _addTextButton(this, m_btnBankExport, "Export bank", 795, 704, 90, 20);
 
     _addTextButton(this,
                    m_lblVersion,
@@ -365,7 +354,7 @@ PluginEditor::PluginEditor (PluginProcessor* ownerFilter, eTfSynth *synth) :
     m_grpGenerator.addChildComponent(&m_freqView);
     m_freqView.setVisible(true);
     m_freqView.setBounds(10, 150, 570, 170);
-    m_freqView.setSynth(ownerFilter, synth, synth->instr[0]);
+    m_freqView.setProcessor(ownerFilter);
 
     // -------------------------------------
     //  FILTER GROUPS
@@ -451,11 +440,15 @@ PluginEditor::PluginEditor (PluginProcessor* ownerFilter, eTfSynth *synth) :
     _addComboBox    (&m_grpFxDelay, m_cmbDelayLeftGrid, delayGridMenuItems(), 15, 76, 50, 18);
     _addComboBox    (&m_grpFxDelay, m_cmbDelayRightGrid, delayGridMenuItems(), 75, 76, 50, 18);
 
-    _addGroupBox(this, m_grpFxEQ, "EQ", 610, 300, 270, 100);
+    _addGroupBox(this, m_grpFxEQ, "EQ", 610, 300, 200, 100);
     _addRotarySlider(&m_grpFxEQ, m_sldEqLow, m_lblEqLow, "-880hz", 10, 25, colEffects);
     _addRotarySlider(&m_grpFxEQ, m_sldEqMid, m_lblEqMid, "880hz-5khz", 70, 25, colEffects);
     _addRotarySlider(&m_grpFxEQ, m_sldEqHigh, m_lblEqHigh, "5khz-", 130, 25, colEffects);
 
+    _addGroupBox(this, m_grpFxConvolution, "CONV", 810, 300, 70, 100);
+    _addRotarySlider(&m_grpFxConvolution, m_sldConvWet, m_lblConvWet, "Wet", 5, 25, colEffects);
+    _addTextButton(&m_grpFxConvolution, m_btnConvLoad, "Load IR", 5, 76, 60, 18);
+
     _addGroupBox(this, m_grpFxChorus, "CHORUS", 610, 400, 270, 100);
     _addRotarySlider(&m_grpFxChorus, m_sldChorusFreq, m_lblChorusFreq, "Frequency", 10, 25, colEffects);
     _addRotarySlider(&m_grpFxChorus, m_sldChorusDepth, m_lblChorusDepth, "Depth", 70, 25, colEffects);
@@ -507,7 +500,7 @@ PluginEditor::PluginEditor (PluginProcessor* ownerFilter, eTfSynth *synth) :
     // -------------------------------------
     //  EFFECT STACK GROUP
     // -------------------------------------
-    const char* FX_SECTIONS = "none|Distortion|Delay|Chorus|Flanger|Reverb|Formant|EQ";
+    const char* FX_SECTIONS = "none|Distortion|Delay|Chorus|Flanger|Reverb|Formant|EQ|Convolution";
     
     _addGroupBox(this, m_grpEffectStack, "EFFECTS STACK", 890, 410, 180, 290);
     _addComboBox(&m_grpEffectStack, m_cmbEffect1, FX_SECTIONS, 10, 25, 160, 20);
@@ -718,6 +711,7 @@ void PluginEditor::refreshUiFromSynth()
     if (!isShowing())
     {
         // we do not refresh the UI, if the window is closed!
+        // changes pile up in the processor until it opens again
         return;
     }
 
@@ -727,204 +721,244 @@ void PluginEditor::refreshUiFromSynth()
 
     bool animationsOn = _configAreAnimationsOn();
     bool waveformsMoving = _configAreWaveformsMoving();
-    bool parametersChanged = processor->wasProgramSwitched() || processor->isParamDirtyAny();
 
-    if (animationsOn || parametersChanged)
+    int changes = processor->collectEditorChanges(m_changedParams);
+    if (m_refreshAll)
     {
-        if (processor->wasProgramSwitched())
-            m_cmbInstrument.setSelectedItemIndex(processor->getCurrentProgram(), dontSendNotification);
-
-        if (processor->isParamDirty(TF_GEN_POLYPHONY))
-            m_cmbPolyphony.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_GEN_POLYPHONY) * (TF_MAXVOICES - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_PITCHWHEEL_UP))
-            m_cmbPitchBendUp.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_PITCHWHEEL_UP) * (TF_MAXPITCHBEND / 2))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_PITCHWHEEL_DOWN))
-            m_cmbPitchBendDown.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_PITCHWHEEL_DOWN) * (TF_MAXPITCHBEND / 2))), dontSendNotification);
-
-        m_sldGlobVolume.setValue(processor->getParameter(TF_GLOBAL_GAIN), dontSendNotification);
-        m_sldGlobFrequency.setValue(processor->getParameter(TF_GEN_FREQ), dontSendNotification);
-        m_sldGlobDetune.setValue(processor->getParameter(TF_GEN_DETUNE), dontSendNotification);
-        m_sldGlobSlop.setValue(processor->getParameter(TF_GEN_SLOP), dontSendNotification);
-        m_sldGlobGlide.setValue(processor->getParameter(TF_GEN_GLIDE), dontSendNotification);
-
-        m_sldGenVolume.setValue(processor->getParameter(TF_GEN_VOLUME), dontSendNotification);
-        m_sldGenPanning.setValue(processor->getParameter(TF_GEN_PANNING), dontSendNotification);
-        m_sldGenSpread.setValue(processor->getParameter(TF_GEN_SPREAD), dontSendNotification);
-        m_sldGenBandwidth.setValue(processor->getParameter(TF_GEN_BANDWIDTH), dontSendNotification);
-        m_sldGenDamp.setValue(processor->getParameter(TF_GEN_DAMP), dontSendNotification);
-        m_sldGenHarmonics.setValue(processor->getParameter(TF_GEN_NUMHARMONICS), dontSendNotification);
-        m_sldGenDrive.setValue(processor->getParameter(TF_GEN_DRIVE), dontSendNotification);
-        m_sldGenScale.setValue(processor->getParameter(TF_GEN_SCALE), dontSendNotification);
-        m_sldGenModulation.setValue(processor->getParameter(TF_GEN_MODULATION), dontSendNotification);
-
-        m_sldNoiseAmount.setValue(processor->getParameter(TF_NOISE_AMOUNT), dontSendNotification);
-        m_sldNoiseFreq.setValue(processor->getParameter(TF_NOISE_FREQ), dontSendNotification);
-        m_sldNoiseBandwidth.setValue(processor->getParameter(TF_NOISE_BW), dontSendNotification);
-
-        m_btnLPOn.setToggleState(processor->getParameter(TF_LP_FILTER_ON) > 0.5f, dontSendNotification);
-        m_sldLPFrequency.setValue(processor->getParameter(TF_LP_FILTER_CUTOFF), dontSendNotification);
-        m_sldLPResonance.setValue(processor->getParameter(TF_LP_FILTER_RESONANCE), dontSendNotification);
-        m_btnHPOn.setToggleState(processor->getParameter(TF_HP_FILTER_ON) > 0.5f, dontSendNotification);
-        m_sldHPFrequency.setValue(processor->getParameter(TF_HP_FILTER_CUTOFF), dontSendNotification);
-        m_sldHPResonance.setValue(processor->getParameter(TF_HP_FILTER_RESONANCE), dontSendNotification);
-        m_btnBPOn.setToggleState(processor->getParameter(TF_BP_FILTER_ON) > 0.5f, dontSendNotification);
-        m_sldBPFrequency.setValue(processor->getParameter(TF_BP_FILTER_CUTOFF), dontSendNotification);
-        m_sldBPQ.setValue(processor->getParameter(TF_BP_FILTER_Q), dontSendNotification);
-        m_btnNTOn.setToggleState(processor->getParameter(TF_NT_FILTER_ON) > 0.5f, dontSendNotification);
-        m_sldNTFrequency.setValue(processor->getParameter(TF_NT_FILTER_CUTOFF), dontSendNotification);
-        m_sldNTQ.setValue(processor->getParameter(TF_NT_FILTER_Q), dontSendNotification);
-
-        m_sldLFO1Rate.setValue(processor->getParameter(TF_LFO1_RATE), dontSendNotification);
-        m_sldLFO1Depth.setValue(processor->getParameter(TF_LFO1_DEPTH), dontSendNotification);
-        m_sldLFO2Rate.setValue(processor->getParameter(TF_LFO2_RATE), dontSendNotification);
-        m_sldLFO2Depth.setValue(processor->getParameter(TF_LFO2_DEPTH), dontSendNotification);
-
-        m_sldADSR1Attack.setValue(processor->getParameter(TF_ADSR1_ATTACK), dontSendNotification);
-        m_sldADSR1Decay.setValue(processor->getParameter(TF_ADSR1_DECAY), dontSendNotification);
-        m_sldADSR1Sustain.setValue(processor->getParameter(TF_ADSR1_SUSTAIN), dontSendNotification);
-        m_sldADSR1Release.setValue(processor->getParameter(TF_ADSR1_RELEASE), dontSendNotification);
-        m_sldADSR1Slope.setValue(processor->getParameter(TF_ADSR1_SLOPE), dontSendNotification);
-
-        m_sldADSR2Attack.setValue(processor->getParameter(TF_ADSR2_ATTACK), dontSendNotification);
-        m_sldADSR2Decay.setValue(processor->getParameter(TF_ADSR2_DECAY), dontSendNotification);
-        m_sldADSR2Sustain.setValue(processor->getParameter(TF_ADSR2_SUSTAIN), dontSendNotification);
-        m_sldADSR2Release.setValue(processor->getParameter(TF_ADSR2_RELEASE), dontSendNotification);
-        m_sldADSR2Slope.setValue(processor->getParameter(TF_ADSR2_SLOPE), dontSendNotification);
-
-        m_sldFlangerFrequency.setValue(processor->getParameter(TF_FLANGER_FREQUENCY), dontSendNotification);
-        m_sldFlangerAmplitude.setValue(processor->getParameter(TF_FLANGER_AMPLITUDE), dontSendNotification);
-        m_sldFlangerLFO.setValue(processor->getParameter(TF_FLANGER_LFO), dontSendNotification);
-        m_sldFlangerWet.setValue(processor->getParameter(TF_FLANGER_WET), dontSendNotification);
-
-        m_sldReverbRoomsize.setValue(processor->getParameter(TF_REVERB_ROOMSIZE), dontSendNotification);
-        m_sldReverbDamp.setValue(processor->getParameter(TF_REVERB_DAMP), dontSendNotification);
-        m_sldReverbWet.setValue(processor->getParameter(TF_REVERB_WET), dontSendNotification);
-        m_sldReverbWidth.setValue(processor->getParameter(TF_REVERB_WIDTH), dontSendNotification);
-
-        m_cmbDelayLeftGrid.setSelectedItemIndex(processor->getParameter(TF_DELAY_LEFT_GRID) * TF_NUM_DELAY_GRIDS, dontSendNotification);
-        m_cmbDelayRightGrid.setSelectedItemIndex(processor->getParameter(TF_DELAY_RIGHT_GRID) * TF_NUM_DELAY_GRIDS, dontSendNotification);
-        m_sldDelayLeft.setValue(processor->getParameter(TF_DELAY_LEFT), dontSendNotification);
-        m_sldDelayRight.setValue(processor->getParameter(TF_DELAY_RIGHT), dontSendNotification);
-        m_sldDelayDecay.setValue(processor->getParameter(TF_DELAY_DECAY), dontSendNotification);
-
-        m_sldChorusFreq.setValue(processor->getParameter(TF_CHORUS_RATE), dontSendNotification);
-        m_sldChorusDepth.setValue(processor->getParameter(TF_CHORUS_DEPTH), dontSendNotification);
-        m_sldChorusGain.setValue(processor->getParameter(TF_CHORUS_GAIN), dontSendNotification);
-
-        m_sldEqLow.setValue(processor->getParameter(TF_EQ_LOW), dontSendNotification);
-        m_sldEqMid.setValue(processor->getParameter(TF_EQ_MID), dontSendNotification);
-        m_sldEqHigh.setValue(processor->getParameter(TF_EQ_HIGH), dontSendNotification);
-
-        m_sldFormantWet.setValue(processor->getParameter(TF_FORMANT_WET), dontSendNotification);
-
-        m_sldDistortionAmount.setValue(processor->getParameter(TF_DISTORT_AMOUNT), dontSendNotification);
-
-        // MOD Matrix Slot 1 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM1_SOURCE))
-            m_cmbMM1Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM1_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM1_TARGET))
-            m_cmbMM1Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM1_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM1Mod.setValue(processor->getParameter(TF_MM1_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 2 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM2_SOURCE))
-            m_cmbMM2Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM2_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM2_TARGET))
-            m_cmbMM2Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM2_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM2Mod.setValue(processor->getParameter(TF_MM2_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 3 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM3_SOURCE))
-            m_cmbMM3Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM3_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM3_TARGET))
-            m_cmbMM3Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM3_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM3Mod.setValue(processor->getParameter(TF_MM3_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 4 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM4_SOURCE))
-            m_cmbMM4Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM4_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM4_TARGET))
-            m_cmbMM4Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM4_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM4Mod.setValue(processor->getParameter(TF_MM4_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 5 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM5_SOURCE))
-            m_cmbMM5Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM5_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM5_TARGET))
-            m_cmbMM5Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM5_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM5Mod.setValue(processor->getParameter(TF_MM5_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 6 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM6_SOURCE))
-            m_cmbMM6Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM6_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM6_TARGET))
-            m_cmbMM6Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM6_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM6Mod.setValue(processor->getParameter(TF_MM6_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 7 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM7_SOURCE))
-            m_cmbMM7Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM7_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
-
-        if (processor->isParamDirty(TF_MM7_TARGET))
-            m_cmbMM7Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM7_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
-
-        m_sldMM7Mod.setValue(processor->getParameter(TF_MM7_MOD), dontSendNotification);
-
-        // MOD Matrix Slot 8 --------------------------------------------------------------
-        if (processor->isParamDirty(TF_MM8_SOURCE))
-            m_cmbMM8Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM8_SOURCE) * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification);
+        m_changedParams.setAll();
+        changes = PluginProcessor::ProgramChanged | PluginProcessor::MasterChanged;
+        m_refreshAll = false;
+    }
 
-        if (processor->isParamDirty(TF_MM8_TARGET))
-            m_cmbMM8Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_MM8_TARGET) * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification);
+    bool parametersChanged = m_changedParams.any();
+    bool generatorChanged = false;
 
-        m_sldMM8Mod.setValue(processor->getParameter(TF_MM8_MOD), dontSendNotification);
+    if (changes & PluginProcessor::ProgramChanged)
+        m_cmbInstrument.setSelectedItemIndex(processor->getCurrentProgram(), dontSendNotification);
 
-        // EFFECTS Section ----------------------------------------------------------------
-        if (processor->isParamDirty(TF_EFFECT_1))
-            m_cmbEffect1.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_1) * TF_MAXEFFECTS)), dontSendNotification);
+    if (parametersChanged)
+    {
+        bool effectsChanged = false;
 
-        if (processor->isParamDirty(TF_EFFECT_2))
-            m_cmbEffect2.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_2) * TF_MAXEFFECTS)), dontSendNotification);
+        for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        {
+            if (m_changedParams.contains(i))
+            {
+                _refreshParam(i);
+                effectsChanged |= (i >= TF_EFFECT_1 && i <= TF_EFFECT_10);
+                generatorChanged |= (i == TF_GEN_BANDWIDTH || i == TF_GEN_DAMP || i == TF_GEN_DRIVE ||
+                                     i == TF_GEN_MODULATION || i == TF_GEN_NUMHARMONICS || i == TF_GEN_SCALE);
+            }
+        }
 
-        if (processor->isParamDirty(TF_EFFECT_3))
-            m_cmbEffect3.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_3) * TF_MAXEFFECTS)), dontSendNotification);
+        if (effectsChanged)
+        {
+            m_grpFxDistortion.setEnabled(_isEffectUsed(1));
+            m_grpFxDelay.setEnabled(_isEffectUsed(2));
+            m_grpFxChorus.setEnabled(_isEffectUsed(3));
+            m_grpFxFlanger.setEnabled(_isEffectUsed(4));
+            m_grpFxReverb.setEnabled(_isEffectUsed(5));
+            m_grpFxFormant.setEnabled(_isEffectUsed(6));
+            m_grpFxEQ.setEnabled(_isEffectUsed(7));
+            m_grpFxConvolution.setEnabled(_isEffectUsed(8));
+        }
 
-        if (processor->isParamDirty(TF_EFFECT_4))
-            m_cmbEffect4.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_4) * TF_MAXEFFECTS)), dontSendNotification);
+        m_changedParams.clear();
+    }
 
-        if (processor->isParamDirty(TF_EFFECT_5))
-            m_cmbEffect5.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_5) * TF_MAXEFFECTS)), dontSendNotification);
+    if (changes & PluginProcessor::MasterChanged)
+    {
+        m_sldMasterPan.setValue(processor->getMasterPan(), dontSendNotification);
+        m_sldMasterVolume.setValue(processor->getMasterVolume(), dontSendNotification);
+    }
 
-        if (processor->isParamDirty(TF_EFFECT_6))
-            m_cmbEffect6.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_6) * TF_MAXEFFECTS)), dontSendNotification);
+    if (animationsOn || parametersChanged)
+    {
+        // -----------------------------------------------------
+        //  Update modulation subvalues for all dials,
+        //  only those that moved get repainted
+        // -----------------------------------------------------
 
-        if (processor->isParamDirty(TF_EFFECT_7))
-            m_cmbEffect7.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_7) * TF_MAXEFFECTS)), dontSendNotification);
+        m_sldGenVolume.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_VOLUME));
+        m_sldGenSpread.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_SPREAD));
+        m_sldGenScale.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_SCALE));
+        m_sldGenPanning.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_PAN));
+        m_sldGenHarmonics.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NUMHARMONICS));
+        m_sldNTQ.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NT_FILTER_Q));
+        m_sldNTFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NT_FILTER_CUTOFF));
+        m_sldNoiseAmount.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NOISE_AMOUNT));
+        m_sldMM8Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD8));
+        m_sldMM7Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD7));
+        m_sldMM6Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD6));
+        m_sldMM5Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD5));
+        m_sldMM4Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD4));
+        m_sldMM3Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD3));
+        m_sldMM2Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD2));
+        m_sldMM1Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD1));
+        m_sldLPResonance.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_LP_FILTER_RESONANCE));
+        m_sldLPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_LP_FILTER_CUTOFF));
+        m_sldHPResonance.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_HP_FILTER_RESONANCE));
+        m_sldHPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_HP_FILTER_CUTOFF));
+        m_sldGlobFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_FREQ));
+        m_sldGenDrive.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DRIVE));
+        m_sldGlobDetune.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DETUNE));
+        m_sldGenDamp.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DAMP));
+        m_sldBPQ.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BP_FILTER_Q));
+        m_sldBPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BP_FILTER_CUTOFF));
+        m_sldGenBandwidth.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BANDWIDTH));
+    }
 
-        if (processor->isParamDirty(TF_EFFECT_8))
-            m_cmbEffect8.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_8) * TF_MAXEFFECTS)), dontSendNotification);
+    if ((animationsOn && waveformsMoving) || (changes & PluginProcessor::ProgramChanged) || generatorChanged)
+    {
+        m_freqView.requestUpdate();
+    }
 
-        if (processor->isParamDirty(TF_EFFECT_9))
-            m_cmbEffect9.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_9) * TF_MAXEFFECTS)), dontSendNotification);
+    // a request made now shows up on one of the next ticks
+    m_freqView.repaintIfChanged();
+}
 
-        if (processor->isParamDirty(TF_EFFECT_10))
-            m_cmbEffect10.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(processor->getParameter(TF_EFFECT_10) * TF_MAXEFFECTS)), dontSendNotification);
+void PluginEditor::_refreshParam(eU32 index)
+{
+    const eF32 value = getProcessor()->getParameter(index);
 
-        switch (static_cast<eU32>(eRoundNearest(processor->getParameter(TF_GEN_UNISONO) * (TF_MAXUNISONO - 1))))
+    switch (index)
+    {
+    case TF_GEN_POLYPHONY:      m_cmbPolyphony.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (TF_MAXVOICES - 1))), dontSendNotification); break;
+    case TF_PITCHWHEEL_UP:      m_cmbPitchBendUp.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (TF_MAXPITCHBEND / 2))), dontSendNotification); break;
+    case TF_PITCHWHEEL_DOWN:    m_cmbPitchBendDown.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (TF_MAXPITCHBEND / 2))), dontSendNotification); break;
+
+    case TF_GLOBAL_GAIN:        m_sldGlobVolume.setValue(value, dontSendNotification); break;
+    case TF_GEN_FREQ:           m_sldGlobFrequency.setValue(value, dontSendNotification); break;
+    case TF_GEN_DETUNE:         m_sldGlobDetune.setValue(value, dontSendNotification); break;
+    case TF_GEN_SLOP:           m_sldGlobSlop.setValue(value, dontSendNotification); break;
+    case TF_GEN_GLIDE:          m_sldGlobGlide.setValue(value, dontSendNotification); break;
+
+    case TF_GEN_VOLUME:         m_sldGenVolume.setValue(value, dontSendNotification); break;
+    case TF_GEN_PANNING:        m_sldGenPanning.setValue(value, dontSendNotification); break;
+    case TF_GEN_SPREAD:         m_sldGenSpread.setValue(value, dontSendNotification); break;
+    case TF_GEN_BANDWIDTH:      m_sldGenBandwidth.setValue(value, dontSendNotification); break;
+    case TF_GEN_DAMP:           m_sldGenDamp.setValue(value, dontSendNotification); break;
+    case TF_GEN_NUMHARMONICS:   m_sldGenHarmonics.setValue(value, dontSendNotification); break;
+    case TF_GEN_DRIVE:          m_sldGenDrive.setValue(value, dontSendNotification); break;
+    case TF_GEN_SCALE:          m_sldGenScale.setValue(value, dontSendNotification); break;
+    case TF_GEN_MODULATION:     m_sldGenModulation.setValue(value, dontSendNotification); break;
+
+    case TF_NOISE_AMOUNT:       m_sldNoiseAmount.setValue(value, dontSendNotification); break;
+    case TF_NOISE_FREQ:         m_sldNoiseFreq.setValue(value, dontSendNotification); break;
+    case TF_NOISE_BW:           m_sldNoiseBandwidth.setValue(value, dontSendNotification); break;
+
+    case TF_LP_FILTER_ON:
+        m_btnLPOn.setToggleState(value > 0.5f, dontSendNotification);
+        m_grpLPFilter.setEnabled(value > 0.5f);
+        break;
+    case TF_LP_FILTER_CUTOFF:   m_sldLPFrequency.setValue(value, dontSendNotification); break;
+    case TF_LP_FILTER_RESONANCE: m_sldLPResonance.setValue(value, dontSendNotification); break;
+    case TF_HP_FILTER_ON:
+        m_btnHPOn.setToggleState(value > 0.5f, dontSendNotification);
+        m_grpHPFilter.setEnabled(value > 0.5f);
+        break;
+    case TF_HP_FILTER_CUTOFF:   m_sldHPFrequency.setValue(value, dontSendNotification); break;
+    case TF_HP_FILTER_RESONANCE: m_sldHPResonance.setValue(value, dontSendNotification); break;
+    case TF_BP_FILTER_ON:
+        m_btnBPOn.setToggleState(value > 0.5f, dontSendNotification);
+        m_grpBPFilter.setEnabled(value > 0.5f);
+        break;
+    case TF_BP_FILTER_CUTOFF:   m_sldBPFrequency.setValue(value, dontSendNotification); break;
+    case TF_BP_FILTER_Q:        m_sldBPQ.setValue(value, dontSendNotification); break;
+    case TF_NT_FILTER_ON:
+        m_btnNTOn.setToggleState(value > 0.5f, dontSendNotification);
+        m_grpNTFilter.setEnabled(value > 0.5f);
+        break;
+    case TF_NT_FILTER_CUTOFF:   m_sldNTFrequency.setValue(value, dontSendNotification); break;
+    case TF_NT_FILTER_Q:        m_sldNTQ.setValue(value, dontSendNotification); break;
+
+    case TF_LFO1_RATE:          m_sldLFO1Rate.setValue(value, dontSendNotification); break;
+    case TF_LFO1_DEPTH:         m_sldLFO1Depth.setValue(value, dontSendNotification); break;
+    case TF_LFO1_SYNC:          m_btnLFO1Sync.setToggleState(value > 0.5, dontSendNotification); break;
+    case TF_LFO2_RATE:          m_sldLFO2Rate.setValue(value, dontSendNotification); break;
+    case TF_LFO2_DEPTH:         m_sldLFO2Depth.setValue(value, dontSendNotification); break;
+    case TF_LFO2_SYNC:          m_btnLFO2Sync.setToggleState(value > 0.5, dontSendNotification); break;
+
+    case TF_ADSR1_ATTACK:       m_sldADSR1Attack.setValue(value, dontSendNotification); break;
+    case TF_ADSR1_DECAY:        m_sldADSR1Decay.setValue(value, dontSendNotification); break;
+    case TF_ADSR1_SUSTAIN:      m_sldADSR1Sustain.setValue(value, dontSendNotification); break;
+    case TF_ADSR1_RELEASE:      m_sldADSR1Release.setValue(value, dontSendNotification); break;
+    case TF_ADSR1_SLOPE:        m_sldADSR1Slope.setValue(value, dontSendNotification); break;
+
+    case TF_ADSR2_ATTACK:       m_sldADSR2Attack.setValue(value, dontSendNotification); break;
+    case TF_ADSR2_DECAY:        m_sldADSR2Decay.setValue(value, dontSendNotification); break;
+    case TF_ADSR2_SUSTAIN:      m_sldADSR2Sustain.setValue(value, dontSendNotification); break;
+    case TF_ADSR2_RELEASE:      m_sldADSR2Release.setValue(value, dontSendNotification); break;
+    case TF_ADSR2_SLOPE:        m_sldADSR2Slope.setValue(value, dontSendNotification); break;
+
+    case TF_FLANGER_FREQUENCY:  m_sldFlangerFrequency.setValue(value, dontSendNotification); break;
+    case TF_FLANGER_AMPLITUDE:  m_sldFlangerAmplitude.setValue(value, dontSendNotification); break;
+    case TF_FLANGER_LFO:        m_sldFlangerLFO.setValue(value, dontSendNotification); break;
+    case TF_FLANGER_WET:        m_sldFlangerWet.setValue(value, dontSendNotification); break;
+
+    case TF_REVERB_ROOMSIZE:    m_sldReverbRoomsize.setValue(value, dontSendNotification); break;
+    case TF_REVERB_DAMP:        m_sldReverbDamp.setValue(value, dontSendNotification); break;
+    case TF_REVERB_WET:         m_sldReverbWet.setValue(value, dontSendNotification); break;
+    case TF_REVERB_WIDTH:       m_sldReverbWidth.setValue(value, dontSendNotification); break;
+
+    case TF_DELAY_LEFT_GRID:    m_cmbDelayLeftGrid.setSelectedItemIndex(value * TF_NUM_DELAY_GRIDS, dontSendNotification); break;
+    case TF_DELAY_RIGHT_GRID:   m_cmbDelayRightGrid.setSelectedItemIndex(value * TF_NUM_DELAY_GRIDS, dontSendNotification); break;
+    case TF_DELAY_LEFT:         m_sldDelayLeft.setValue(value, dontSendNotification); break;
+    case TF_DELAY_RIGHT:        m_sldDelayRight.setValue(value, dontSendNotification); break;
+    case TF_DELAY_DECAY:        m_sldDelayDecay.setValue(value, dontSendNotification); break;
+
+    case TF_CHORUS_RATE:        m_sldChorusFreq.setValue(value, dontSendNotification); break;
+    case TF_CHORUS_DEPTH:       m_sldChorusDepth.setValue(value, dontSendNotification); break;
+    case TF_CHORUS_GAIN:        m_sldChorusGain.setValue(value, dontSendNotification); break;
+
+    case TF_EQ_LOW:             m_sldEqLow.setValue(value, dontSendNotification); break;
+    case TF_EQ_MID:             m_sldEqMid.setValue(value, dontSendNotification); break;
+    case TF_EQ_HIGH:            m_sldEqHigh.setValue(value, dontSendNotification); break;
+
+    case TF_CONV_WET:           m_sldConvWet.setValue(value, dontSendNotification); break;
+    case TF_FORMANT_WET:        m_sldFormantWet.setValue(value, dontSendNotification); break;
+    case TF_DISTORT_AMOUNT:     m_sldDistortionAmount.setValue(value, dontSendNotification); break;
+
+    // MOD Matrix -----------------------------------------------------------------
+    case TF_MM1_SOURCE:         m_cmbMM1Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM1_TARGET:         m_cmbMM1Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM1_MOD:            m_sldMM1Mod.setValue(value, dontSendNotification); break;
+    case TF_MM2_SOURCE:         m_cmbMM2Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM2_TARGET:         m_cmbMM2Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM2_MOD:            m_sldMM2Mod.setValue(value, dontSendNotification); break;
+    case TF_MM3_SOURCE:         m_cmbMM3Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM3_TARGET:         m_cmbMM3Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM3_MOD:            m_sldMM3Mod.setValue(value, dontSendNotification); break;
+    case TF_MM4_SOURCE:         m_cmbMM4Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM4_TARGET:         m_cmbMM4Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM4_MOD:            m_sldMM4Mod.setValue(value, dontSendNotification); break;
+    case TF_MM5_SOURCE:         m_cmbMM5Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM5_TARGET:         m_cmbMM5Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM5_MOD:            m_sldMM5Mod.setValue(value, dontSendNotification); break;
+    case TF_MM6_SOURCE:         m_cmbMM6Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM6_TARGET:         m_cmbMM6Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM6_MOD:            m_sldMM6Mod.setValue(value, dontSendNotification); break;
+    case TF_MM7_SOURCE:         m_cmbMM7Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM7_TARGET:         m_cmbMM7Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM7_MOD:            m_sldMM7Mod.setValue(value, dontSendNotification); break;
+    case TF_MM8_SOURCE:         m_cmbMM8Src.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::INPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM8_TARGET:         m_cmbMM8Dest.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * (eTfModMatrix::OUTPUT_COUNT - 1))), dontSendNotification); break;
+    case TF_MM8_MOD:            m_sldMM8Mod.setValue(value, dontSendNotification); break;
+
+    // EFFECTS Section ------------------------------------------------------------
+    case TF_EFFECT_1:           m_cmbEffect1.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_2:           m_cmbEffect2.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_3:           m_cmbEffect3.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_4:           m_cmbEffect4.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_5:           m_cmbEffect5.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_6:           m_cmbEffect6.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_7:           m_cmbEffect7.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_8:           m_cmbEffect8.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_9:           m_cmbEffect9.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+    case TF_EFFECT_10:          m_cmbEffect10.setSelectedItemIndex(static_cast<eU32>(eRoundNearest(value * TF_MAXEFFECTS)), dontSendNotification); break;
+
+    case TF_GEN_UNISONO:
+        switch (static_cast<eU32>(eRoundNearest(value * (TF_MAXUNISONO - 1))))
         {
         case 0: m_btnGenUnisono1.setToggleState(true, dontSendNotification); break;
         case 1: m_btnGenUnisono2.setToggleState(true, dontSendNotification); break;
@@ -937,8 +971,10 @@ void PluginEditor::refreshUiFromSynth()
         case 8: m_btnGenUnisono9.setToggleState(true, dontSendNotification); break;
         case 9: m_btnGenUnisono10.setToggleState(true, dontSendNotification); break;
         }
+        break;
 
-        switch (static_cast<eU32>(eRoundNearest(processor->getParameter(TF_GEN_OCTAVE) * (TF_MAXOCTAVES - 1))))
+    case TF_GEN_OCTAVE:
+        switch (static_cast<eU32>(eRoundNearest(value * (TF_MAXOCTAVES - 1))))
         {
         case 8: m_btnGenOctave1.setToggleState(true, dontSendNotification); break;
         case 7: m_btnGenOctave2.setToggleState(true, dontSendNotification); break;
@@ -950,8 +986,10 @@ void PluginEditor::refreshUiFromSynth()
         case 1: m_btnGenOctave8.setToggleState(true, dontSendNotification); break;
         case 0: m_btnGenOctave9.setToggleState(true, dontSendNotification); break;
         }
+        break;
 
-        switch (static_cast<eU32>(eRoundNearest(processor->getParameter(TF_LFO1_SHAPE) * (TF_LFOSHAPECOUNT - 1))))
+    case TF_LFO1_SHAPE:
+        switch (static_cast<eU32>(eRoundNearest(value * (TF_LFOSHAPECOUNT - 1))))
         {
         case 0: m_btnLFO1ShapeSine.setToggleState(true, dontSendNotification); break;
         case 1: m_btnLFO1ShapeSawDown.setToggleState(true, dontSendNotification); break;
@@ -959,9 +997,10 @@ void PluginEditor::refreshUiFromSynth()
         case 3: m_btnLFO1ShapeSquare.setToggleState(true, dontSendNotification); break;
         case 4: m_btnLFO1ShapeNoise.setToggleState(true, dontSendNotification); break;
         }
-        m_btnLFO1Sync.setToggleState(processor->getParameter(TF_LFO1_SYNC) > 0.5, dontSendNotification);
+        break;
 
-        switch (static_cast<eU32>(eRoundNearest(processor->getParameter(TF_LFO2_SHAPE) * (TF_LFOSHAPECOUNT - 1))))
+    case TF_LFO2_SHAPE:
+        switch (static_cast<eU32>(eRoundNearest(value * (TF_LFOSHAPECOUNT - 1))))
         {
         case 0: m_btnLFO2ShapeSine.setToggleState(true, dontSendNotification); break;
         case 1: m_btnLFO2ShapeSawDown.setToggleState(true, dontSendNotification); break;
@@ -969,9 +1008,10 @@ void PluginEditor::refreshUiFromSynth()
         case 3: m_btnLFO2ShapeSquare.setToggleState(true, dontSendNotification); break;
         case 4: m_btnLFO2ShapeNoise.setToggleState(true, dontSendNotification); break;
         }
-        m_btnLFO2Sync.setToggleState(processor->getParameter(TF_LFO2_SYNC) > 0.5, dontSendNotification);
+        break;
 
-        switch (static_cast<eU32>(eRoundNearest(processor->getParameter(TF_FORMANT_MODE) * (TF_FORMANTCOUNT - 1))))
+    case TF_FORMANT_MODE:
+        switch (static_cast<eU32>(eRoundNearest(value * (TF_FORMANTCOUNT - 1))))
         {
         case 0: m_btnFormantA.setToggleState(true, dontSendNotification); break;
         case 1: m_btnFormantE.setToggleState(true, dontSendNotification); break;
@@ -979,65 +1019,8 @@ void PluginEditor::refreshUiFromSynth()
         case 3: m_btnFormantO.setToggleState(true, dontSendNotification); break;
         case 4: m_btnFormantU.setToggleState(true, dontSendNotification); break;
         }
-
-        // -----------------------------------------------------
-        //  Update modulation subvalues for all dials
-        // -----------------------------------------------------
-
-        m_sldGenVolume.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_VOLUME));
-        m_sldGenSpread.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_SPREAD));
-        m_sldGenScale.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_SCALE));
-        m_sldGenPanning.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_PAN));
-        m_sldGenHarmonics.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NUMHARMONICS));
-        m_sldNTQ.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NT_FILTER_Q));
-        m_sldNTFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NT_FILTER_CUTOFF));
-        m_sldNoiseAmount.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_NOISE_AMOUNT));
-        m_sldMM8Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD8));
-        m_sldMM7Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD7));
-        m_sldMM6Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD6));
-        m_sldMM5Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD5));
-        m_sldMM4Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD4));
-        m_sldMM3Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD3));
-        m_sldMM2Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD2));
-        m_sldMM1Mod.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_MOD1));
-        m_sldLPResonance.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_LP_FILTER_RESONANCE));
-        m_sldLPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_LP_FILTER_CUTOFF));
-        m_sldHPResonance.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_HP_FILTER_RESONANCE));
-        m_sldHPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_HP_FILTER_CUTOFF));
-        m_sldGlobFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_FREQ));
-        m_sldGenDrive.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DRIVE));
-        m_sldGlobDetune.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DETUNE));
-        m_sldGenDamp.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_DAMP));
-        m_sldBPQ.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BP_FILTER_Q));
-        m_sldBPFrequency.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BP_FILTER_CUTOFF));
-        m_sldGenBandwidth.setModValue(processor->getParameterMod(eTfModMatrix::OUTPUT_BANDWIDTH));
+        break;
     }
-
-    if ((animationsOn && waveformsMoving) || processor->wasProgramSwitched())
-    {
-        m_freqView.repaint();
-    }
-    
-    if (parametersChanged)
-    {
-        m_grpLPFilter.setEnabled(processor->getParameter(TF_LP_FILTER_ON) > 0.5);
-        m_grpHPFilter.setEnabled(processor->getParameter(TF_HP_FILTER_ON) > 0.5);
-        m_grpBPFilter.setEnabled(processor->getParameter(TF_BP_FILTER_ON) > 0.5);
-        m_grpNTFilter.setEnabled(processor->getParameter(TF_NT_FILTER_ON) > 0.5);
-        
-        m_grpFxDistortion.setEnabled(_isEffectUsed(1));
-        m_grpFxDelay.setEnabled(_isEffectUsed(2));
-        m_grpFxChorus.setEnabled(_isEffectUsed(3));
-        m_grpFxFlanger.setEnabled(_isEffectUsed(4));
-        m_grpFxReverb.setEnabled(_isEffectUsed(5));
-        m_grpFxFormant.setEnabled(_isEffectUsed(6));
-        m_grpFxEQ.setEnabled(_isEffectUsed(7));
-        
-        m_sldMasterPan.setValue(processor->getMasterPan());
-        m_sldMasterVolume.setValue(processor->getMasterVolume());
-    }
-    
-    processor->resetParamDirty();
 }
 
 
@@ -1053,7 +1036,7 @@ void PluginEditor::_setParameterNotifyingHost(Slider *slider, eTfParam param)
         param == TF_GEN_NUMHARMONICS ||
         param == TF_GEN_SCALE)
     {
-        m_freqView.repaint();
+        m_freqView.requestUpdate();
     }
 }
 
@@ -1136,6 +1119,7 @@ void PluginEditor::sliderValueChanged (Slider* slider)
     else if (slider == &m_sldEqLow)             _setParameterNotifyingHost(slider, TF_EQ_LOW);
     else if (slider == &m_sldEqMid)             _setParameterNotifyingHost(slider, TF_EQ_MID);
     else if (slider == &m_sldEqHigh)            _setParameterNotifyingHost(slider, TF_EQ_HIGH);
+    else if (slider == &m_sldConvWet)           _setParameterNotifyingHost(slider, TF_CONV_WET);
 
     else if (slider == &m_sldChorusFreq)        _setParameterNotifyingHost(slider, TF_CHORUS_RATE);
     else if (slider == &m_sldChorusDepth)       _setParameterNotifyingHost(slider, TF_CHORUS_DEPTH);
@@ -1207,7 +1191,7 @@ void PluginEditor::comboBoxChanged (ComboBox* comboBox)
         {
             tfProcessor->setCurrentProgram(index);
             tfProcessor->updateHostDisplay();
-            m_freqView.repaint();
+            m_freqView.requestUpdate();
         }
         else
         {
@@ -1285,7 +1269,7 @@ void PluginEditor::buttonClicked (Button *button)
             m_cmbInstrument.setSelectedItemIndex(currentProgram);
             processor->setCurrentProgram(currentProgram);
             processor->updateHostDisplay();
-            m_freqView.repaint();
+            m_freqView.requestUpdate();
         }
     }
     else if (button == &m_btnNext)
@@ -1298,7 +1282,7 @@ void PluginEditor::buttonClicked (Button *button)
             m_cmbInstrument.setSelectedItemIndex(currentProgram);
             processor->setCurrentProgram(currentProgram);
             processor->updateHostDisplay();
-            m_freqView.repaint();
+            m_freqView.requestUpdate();
         }
     }
     else if (button == &m_btnCopy)
@@ -1310,7 +1294,7 @@ void PluginEditor::buttonClicked (Button *button)
         processor->presetPaste();
         _fillProgramCombobox();
         processor->updateHostDisplay();
-        m_freqView.repaint();
+        m_freqView.requestUpdate();
     }
     else if (button == &m_btnSave)
     {
@@ -1320,7 +1304,7 @@ void PluginEditor::buttonClicked (Button *button)
     {
         processor->presetRestore();
         processor->updateHostDisplay();
-        m_freqView.repaint();
+        m_freqView.requestUpdate();
     }
     else if (button == &m_btnAnimationsOn)
     {
@@ -1338,6 +1322,42 @@ void PluginEditor::buttonClicked (Button *button)
         bool movingWaveforms = m_btnMovingWaveforms.getToggleState();
         _configSetWaveformsMoving(movingWaveforms);
     }
+    else if (button == &m_btnConvLoad)
+    {
+        FileChooser chooser ("Load Impulse Response",
+                             processor->getImpulseResponseFile(),
+                             "*.wav;*.aif;*.aiff");
+        // decoding and transforming happens on the loader thread
+        if (chooser.browseForFileToOpen())
+            processor->loadImpulseResponse(chooser.getResult());
+    }
+    else if (button == &m_btnBankImport)
+    {
+        FileChooser chooser ("Import Bank", File::getSpecialLocation(File::userHomeDirectory));
+        // the imported programs are saved to the user bank in the background
+        if (chooser.browseForDirectory())
+        {
+            processor->bankImport(chooser.getResult());
+            _fillProgramCombobox();
+            m_freqView.requestUpdate();
+        }
+    }
+    else if (button == &m_btnBankExport)
+    {
+        FileChooser chooser ("Export Bank", File::getSpecialLocation(File::userHomeDirectory));
+        if (chooser.browseForDirectory())
+            processor->bankExport(chooser.getResult());
+    }
+    else if (button == &m_btnPipelinedFx)
+    {
+        // effects run one block behind on a second core, adds latency
+        processor->setPipelinedEffects(m_btnPipelinedFx.getToggleState());
+    }
+    else if (button == &m_btnMultiTimbral)
+    {
+        // MIDI channels 2-16 play parts of their own
+        processor->setMultiTimbral(m_btnMultiTimbral.getToggleState());
+    }
     else
     {
         AboutComponent::openAboutWindow(this);
@@ -1350,7 +1370,7 @@ bool PluginEditor::_isEffectUsed(eU32 effectNum)
     
     for (int fxSlot = TF_EFFECT_1; fxSlot <= TF_EFFECT_10; ++fxSlot)
     {
-        // "none|Distortion|Delay|Chorus|Flanger|Reverb|Formant|EQ"
+        // "none|Distortion|Delay|Chorus|Flanger|Reverb|Formant|EQ|Convolution"
         if ((eU32)round(processor->getParameter(fxSlot) * TF_MAXEFFECTS) == effectNum)
             return true;
     }
@@ -46,16 +46,18 @@ class eTfFreqView : public GroupComponent
 {
 public:
     eTfFreqView();
-    ~eTfFreqView();
 
     void paint (Graphics& g);
-    void setSynth(PluginProcessor *processor, eTfSynth *synth, eTfInstrument *instr);
+    void setProcessor(PluginProcessor *processor);
+
+    // asks the audio thread to render a new preview
+    void requestUpdate();
+    // repaints once a preview newer than the one shown is there
+    void repaintIfChanged();
 
 private:
-    eTfSynth *          m_synth;
-    eTfInstrument *     m_instr;
-    eTfVoice *          m_voice;
     PluginProcessor *   m_processor;
+    eU32                m_generation;
 };
 
 class eTfSlider : public Slider
@@ -118,6 +120,7 @@ private:
     void _fillProgramCombobox();
     void _createIcons();
     void _resetTimer();
+    void _refreshParam(eU32 index);
     bool _isEffectUsed(eU32 effectNum);
 
     bool _configAreAnimationsOn();
@@ -132,6 +135,10 @@ private:
     TextButton m_btnAnimationsOn;
     TextButton m_btnFastAnimations;
     TextButton m_btnMovingWaveforms;
+    TextButton m_btnPipelinedFx;
+    TextButton m_btnMultiTimbral;
+    TextButton m_btnBankImport;
+    TextButton m_btnBankExport;
 
     // -------------------------------------
     //  COMPONENT GROUPS
@@ -150,6 +157,7 @@ private:
     eTfGroupComponent m_grpFxReverb;
     eTfGroupComponent m_grpFxDelay;
     eTfGroupComponent m_grpFxEQ;
+    eTfGroupComponent m_grpFxConvolution;
     eTfGroupComponent m_grpFxChorus;
     eTfGroupComponent m_grpFxFormant;
     eTfGroupComponent m_grpFxDistortion;
@@ -363,6 +371,10 @@ private:
     Label m_lblEqMid;
     Label m_lblEqHigh;
 
+    eTfSlider m_sldConvWet;
+    Label m_lblConvWet;
+    TextButton m_btnConvLoad;
+
     eTfSlider m_sldChorusFreq;
     eTfSlider m_sldChorusDepth;
     eTfSlider m_sldChorusGain;
@@ -436,6 +448,10 @@ private:
     Label       m_lblMasterPan;
     eTfSlider   m_sldMasterVolume;
     Label       m_lblMasterVolume;
+
+    // parameters changed since the last refresh, everything on the first
+    eTfParameterStore::Changes m_changedParams;
+    bool        m_refreshAll;
 };
 
 
@@ -60,22 +60,50 @@ static File presetsDirectory (bool factory)
 }
 
 
+/**
+ Besides the main output, every part of the multi-timbral mode has an output
+ bus of its own. These are off by default, parts then mix into the main output.
+ */
+
+static AudioProcessor::BusesProperties partBuses()
+{
+    AudioProcessor::BusesProperties buses = AudioProcessor::BusesProperties()
+        .withInput ("Input", AudioChannelSet::stereo(), true)
+        .withOutput ("Output", AudioChannelSet::stereo(), true);
+
+    for (eU32 part=1; part<TF_PLUG_NUM_PARTS; part++)
+        buses = buses.withOutput ("Part " + String(part + 1), AudioChannelSet::stereo(), false);
+
+    return buses;
+}
+
 //==============================================================================
 
 PluginProcessor::PluginProcessor() :
+    AudioProcessor(partBuses()),
     tf(nullptr),
     synth(nullptr),
-    paramDirtyAny(false),
+    waveformPreviewGeneration(0),
+    previewVoice(nullptr),
+    previewInstr(nullptr),
+    pipelineRunning(false),
+    partsRunning(false),
+    editorChanges(0),
     currentProgramIndex(0),
     currentProgram(new eTfSynthProgram()),
     adapterWriteOffset(0),
     adapterDataAvailable(0),
+    holdDeferredEvents(false),
     masterGain(1.0),
     masterPan(0.5),
     requestedBank_MSB(0),
     requestedBank_LSB(0),
-    requestedPreset(0)
+    pendingProgram(-1),
+    programsCollected(0)
 {
+    programWriter = new ProgramWriter();
+    programWriter->startThread();
+
     meterLevels[0] = 0;
     meterLevels[1] = 0;
     metering.set(0);
@@ -89,14 +117,41 @@ PluginProcessor::PluginProcessor() :
 
     synth->instr[0] = tf = new eTfInstrument();
     eTfInstrumentInit(*synth, *tf);
+    previewVoice = new eTfVoice(eFALSE);
+    previewInstr = new eTfInstrument();
+    waveformPreviewThread = new WaveformPreviewThread(*this);
+    waveformPreviewThread->startThread();
+
+    eTfEffectPoolInit(effectPool, synth->sampleRate);
+    tf->effectPool = &effectPool;
+    effectPoolThread = new EffectPoolThread(effectPool);
+    effectPoolThread->startThread();
+
+    eTfConvolutionIrExchangeInit(convolutionIr);
+    tf->convolutionIr = &convolutionIr;
+    impulseResponseLoader = new ImpulseResponseLoader(*synth, convolutionIr);
+    impulseResponseLoader->setSampleRate(synth->sampleRate);
+    impulseResponseLoader->startThread();
+
+    eMemSet(programTableEdited, 0, sizeof(programTableEdited));
 
     for (auto i=0; i < TF_PLUG_NUM_PROGRAMS; i++)
     {
         programs[i].loadDefault(i);
-        privateLoadProgram(i);
+        programLoaded[i] = false;
+        pushProgram(i);
     }
-    programs[currentProgramIndex].applyToSynth(tf);
-    resetParamDirty(true);
+
+    // only the active program is loaded right away, the others
+    // become available as the loader gets to them
+    ensureProgramLoaded(currentProgramIndex.get());
+    programLoader = new ProgramLoader(presetsDirectory(false), presetsDirectory(true));
+    programLoader->addChangeListener(this);
+    programLoader->startThread();
+
+    programs[currentProgramIndex.get()].applyToSynth(parameters);
+    parameters.apply(*tf);
+    updateTailLength();
     
     addChangeListener(this);
 }
@@ -104,9 +159,38 @@ PluginProcessor::PluginProcessor() :
 PluginProcessor::~PluginProcessor()
 {
     removeChangeListener(this);
+    programLoader->removeChangeListener(this);
+    programLoader = nullptr;
+    bankImporter = nullptr;
+    // writes whatever is still queued
+    programWriter = nullptr;
+    effectChain = nullptr;
+    impulseResponseLoader->stopThread(5000);
+    impulseResponseLoader = nullptr;
+    effectPoolThread->stopThread(1000);
+    effectPoolThread = nullptr;
+    waveformPreviewThread->stopThread(1000);
+    waveformPreviewThread = nullptr;
+
+    for (SynthPart *part : parts)
+    {
+        eTfInstrumentFreeEffects(*part->instr);
+        eTfEffectPoolFree(part->effectPool);
+        eDeleteArray(part->buffer[0]);
+        eDeleteArray(part->buffer[1]);
+        eDelete(part->instr);
+    }
+    parts.clear();
+
+    eTfInstrumentFreeEffects(*tf);
+    eTfEffectPoolFree(effectPool);
+    eTfConvolutionIrExchangeFree(convolutionIr);
     eDelete(adapterBuffer[0]);
     eDelete(adapterBuffer[1]);
+    eDelete(previewVoice);
+    eDelete(previewInstr);
     eDelete(tf);
+    eTfSynthFree(*synth);
     eDelete(synth);
 }
 
@@ -121,7 +205,7 @@ float PluginProcessor::delayFromGrid (int paramIndex, float paramGridValue, doub
     
     const int grid = round(TF_NUM_DELAY_GRIDS * paramGridValue);
     if (grid == 0) // free
-        return tf->params[paramIndex];
+        return parameters.get(paramIndex);
     
     if (bpm == 0)
     {
@@ -135,20 +219,158 @@ float PluginProcessor::delayFromGrid (int paramIndex, float paramGridValue, doub
 
 void PluginProcessor::setDelaysFromTempo (double bpm)
 {
-    ScopedLock sl (getSynthCriticalSection());
-    
-    float grid = tf->params[TF_DELAY_RIGHT_GRID];
+    float grid = parameters.get(TF_DELAY_RIGHT_GRID);
+    if (grid > 0.0f)
+        parameters.set(TF_DELAY_RIGHT, delayFromGrid(TF_DELAY_RIGHT, grid));
+    grid = parameters.get(TF_DELAY_LEFT_GRID);
     if (grid > 0.0f)
+        parameters.set(TF_DELAY_LEFT, delayFromGrid(TF_DELAY_LEFT, grid));
+}
+
+
+bool PluginProcessor::isPipelinedEffects() const
+{
+    return pipelinedEffects.get() != 0;
+}
+
+void PluginProcessor::setPipelinedEffects (bool on)
+{
+    if (on == isPipelinedEffects())
+        return;
+
+    // the thread is created once and then kept, the audio
+    // thread switches modes by itself at the next block
+    if (on && effectChain == nullptr)
+        effectChain = new EffectChain(*workerPool, *synth, *tf);
+
+    pipelinedEffects.set(on);
+    setLatencySamples(on ? TF_BUFFERSIZE : 0);
+    updateHostDisplay();
+}
+
+
+bool PluginProcessor::isMultiTimbral() const
+{
+    return multiTimbral.get() != 0;
+}
+
+void PluginProcessor::setMultiTimbral (bool on)
+{
+    if (on == isMultiTimbral())
+        return;
+
+    if (on && parts.isEmpty())
+        createParts();
+
+    multiTimbral.set(on);
+}
+
+void PluginProcessor::createParts()
+{
+    for (eU32 i=1; i<TF_PLUG_NUM_PARTS; i++)
     {
-        tf->params[TF_DELAY_RIGHT] = delayFromGrid(TF_DELAY_RIGHT, grid);
-        paramDirty[TF_DELAY_RIGHT] = eTRUE;
+        SynthPart *part = parts.add(new SynthPart());
+
+        part->instr = new eTfInstrument();
+        eTfInstrumentInit(*synth, *part->instr);
+        eTfEffectPoolInit(part->effectPool, synth->sampleRate);
+        part->instr->effectPool = &part->effectPool;
+        effectPoolThread->addPool(part->effectPool);
+
+        part->buffer[0] = new eF32[TF_BUFFERSIZE];
+        part->buffer[1] = new eF32[TF_BUFFERSIZE];
+        part->bankMSB = 0;
+        part->bankLSB = 0;
+        part->active = false;
+        part->program.set(0);
+        part->pendingProgram.set(0);
+        part->volume.set(FaderPosUnity);
+        part->pan.set(0.5f);
+
+        synth->instr[i] = part->instr;
     }
-    grid = tf->params[TF_DELAY_LEFT_GRID];
-    if (grid > 0.0f)
+}
+
+void PluginProcessor::renderPart (void *context, eU32 index)
+{
+    PluginProcessor &processor = *static_cast<PluginProcessor *>(context);
+    SynthPart &part = *processor.activeParts[index];
+
+    eMemSet(part.buffer[0], 0, TF_BUFFERSIZE * sizeof(eF32));
+    eMemSet(part.buffer[1], 0, TF_BUFFERSIZE * sizeof(eF32));
+    eTfInstrumentProcess(*processor.synth, *part.instr, part.buffer, TF_BUFFERSIZE);
+}
+
+// the audio thread holds programLock
+void PluginProcessor::switchPartPrograms()
+{
+    for (SynthPart *part : parts)
+    {
+        const int index = part->pendingProgram.exchange(-1);
+        if (index < 0)
+            continue;
+
+        for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+            eTfInstrumentSetParam(*part->instr, i, programTable[index][i]);
+
+        part->program.set(index);
+    }
+}
+
+void PluginProcessor::mixParts (AudioSampleBuffer &buffer, eU32 offset, eU32 srcOffset, eU32 len)
+{
+    for (int i=0; i<parts.size(); i++)
+    {
+        const SynthPart &part = *parts.getUnchecked(i);
+        if (!part.active)
+            continue;
+
+        // parts without an enabled bus of their own go to the main output
+        int bus = i + 1;
+        if (bus >= getBusCount(false) || getChannelCountOfBus(false, bus) != 2)
+            bus = 0;
+
+        // balance rather than a pan law, so a centered part stays at unity gain
+        const float gain = convertFaderToGain6dB(part.volume.get());
+        const float pan = part.pan.get();
+        const float left = gain * jmin(1.0f, 2.0f - 2.0f * pan);
+        const float right = gain * jmin(1.0f, 2.0f * pan);
+
+        const int channel = getChannelIndexInProcessBlockBuffer(false, bus, 0);
+        FloatVectorOperations::addWithMultiply(buffer.getWritePointer(channel, offset), part.buffer[0] + srcOffset, left, len);
+        FloatVectorOperations::addWithMultiply(buffer.getWritePointer(channel + 1, offset), part.buffer[1] + srcOffset, right, len);
+    }
+}
+
+bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    if (layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+        return false;
+
+    for (const AudioChannelSet &set : layouts.outputBuses)
+    {
+        if (!set.isDisabled() && set != AudioChannelSet::stereo())
+            return false;
+    }
+
+    for (const AudioChannelSet &set : layouts.inputBuses)
     {
-        tf->params[TF_DELAY_LEFT] = delayFromGrid(TF_DELAY_LEFT, grid);
-        paramDirty[TF_DELAY_LEFT] = eTRUE;
+        if (!set.isDisabled() && set != AudioChannelSet::stereo())
+            return false;
     }
+
+    return true;
+}
+
+
+File PluginProcessor::getImpulseResponseFile() const
+{
+    return impulseResponseLoader->getFile();
+}
+
+void PluginProcessor::loadImpulseResponse (const File &file)
+{
+    impulseResponseLoader->load(file);
 }
 
 
@@ -165,65 +387,78 @@ int PluginProcessor::getNumParameters()
 bool PluginProcessor::isMetaParameter (int index) const
 {
     // the new delay grids are meta parameters!
-    return index >= TF_PARAM_COUNT - 2;
+    return index == TF_DELAY_LEFT_GRID || index == TF_DELAY_RIGHT_GRID;
 }
 
 float PluginProcessor::getParameterMod(int index)
 {
-    eTfVoice *voice = tf->latestTriggeredVoice;
-    if (!voice)
-        return 0.0f;
-
-    if (!voice->playing)
+    const VoiceSnapshot &voice = getVoiceSnapshot();
+    if (!voice.playing)
         return 0.0f;
 
-    eF32 value = eTfModMatrixGet(voice->modMatrix, static_cast<eTfModMatrix::Output>(index));
+    eF32 value = eTfModMatrixGet(voice.modMatrix, static_cast<eTfModMatrix::Output>(index));
     if (value == 1.0f)
         return 0.0f;
 
     return value;
 }
 
+const PluginProcessor::VoiceSnapshot & PluginProcessor::getVoiceSnapshot()
+{
+    return voiceSnapshot.read();
+}
+
+const PluginProcessor::WaveformPreview & PluginProcessor::getWaveformPreview()
+{
+    return waveformPreview.read();
+}
+
+// the preview thread renders it when the host has stopped
+// processing blocks, the audio thread would not get to it
+static const uint32 PreviewIdleTime = 100; // ms
+
+void PluginProcessor::requestWaveformPreview()
+{
+    waveformPreviewRequested.set(1);
+
+    if (Time::getMillisecondCounter() - lastBlockTime.get() > PreviewIdleTime)
+        waveformPreviewThread->notify();
+}
+
+void PluginProcessor::WaveformPreviewThread::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (!threadShouldExit())
+            processor.publishIdleWaveformPreview();
+    }
+}
+
 float PluginProcessor::getParameter (int index)
 {
     eASSERT(index >= 0 && index < TF_PARAM_COUNT);
-    return tf->params[index];
+    return parameters.get(index);
 }
 
 void PluginProcessor::setParameter (int index, float newValue)
 {
-    ScopedLock sl (getSynthCriticalSection());
-    
     eASSERT(index >= 0 && index < TF_PARAM_COUNT);
     
-    tf->params[index] = newValue;
-    paramDirty[index] = eTRUE;
+    parameters.set(index, newValue);
     
     // Have delay sliders reflect grid setting
     if (index == TF_DELAY_RIGHT_GRID)
-    {
-        tf->params[TF_DELAY_RIGHT] = delayFromGrid(TF_DELAY_RIGHT, newValue);
-        paramDirty[TF_DELAY_RIGHT] = eTRUE;
-    }
+        parameters.set(TF_DELAY_RIGHT, delayFromGrid(TF_DELAY_RIGHT, newValue));
     if (index == TF_DELAY_LEFT_GRID)
-    {
-        tf->params[TF_DELAY_LEFT] = delayFromGrid(TF_DELAY_LEFT, newValue);
-        paramDirty[TF_DELAY_LEFT] = eTRUE;
-    }
+        parameters.set(TF_DELAY_LEFT, delayFromGrid(TF_DELAY_LEFT, newValue));
     // Reset delay grids to 'free' if sliders are moved manually
     if (index == TF_DELAY_RIGHT)
-    {
-        tf->params[TF_DELAY_RIGHT_GRID] = 0;
-        paramDirty[TF_DELAY_RIGHT_GRID] = eTRUE;
-    }
+        parameters.set(TF_DELAY_RIGHT_GRID, 0);
     
     if (index == TF_DELAY_LEFT)
-    {
-        tf->params[TF_DELAY_LEFT_GRID] = 0;
-        paramDirty[TF_DELAY_LEFT_GRID] = eTRUE;
-    }
-    
-    paramDirtyAny = true;
+        parameters.set(TF_DELAY_LEFT_GRID, 0);
 }
 
 const String PluginProcessor::getParameterName (int index)
@@ -282,7 +517,7 @@ bool PluginProcessor::silenceInProducesSilenceOut() const
 
 double PluginProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLength.get();
 }
 
 int PluginProcessor::getNumPrograms()
@@ -292,29 +527,74 @@ int PluginProcessor::getNumPrograms()
 
 int PluginProcessor::getCurrentProgram()
 {
-    return currentProgramIndex;
+    return currentProgramIndex.get();
 }
 
 void PluginProcessor::setCurrentProgram (int index)
 {
-    if (currentProgramIndex == index)
+    if (currentProgramIndex.get() == index)
         return;
 
     eASSERT(index >= 0 && index < TF_PLUG_NUM_PROGRAMS);
 
-    // write program from tunefish to program list before switching
-    programs[currentProgramIndex].loadFromSynth(tf);
-    currentProgramIndex = index;
-    // load new program to into tunefish
-    programs[currentProgramIndex].applyToSynth(tf);
-    resetParamDirty(true);
+    ensureProgramLoaded(index);
+    {
+        const SpinLock::ScopedLockType sl (programLock);
+        switchProgram(index);
+        pullProgramEdits();
+    }
+
+    notifyEditor(ProgramChanged);
     // required to please AU hosts:
     updateHostDisplay();
 }
 
+void PluginProcessor::switchProgram (int index)
+{
+    const int current = currentProgramIndex.get();
+    if (index == current)
+        return;
+
+    // keep the edits made to the current program before switching,
+    // they reach programs[] on the message thread in pullProgramEdits()
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        programTable[current][i] = parameters.get(i);
+
+    programTableEdited[current / 32] |= 1u << (current % 32);
+
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        parameters.set(i, programTable[index][i]);
+
+    currentProgramIndex.set(index);
+}
+
+void PluginProcessor::pushProgram (eU32 index)
+{
+    eMemCopy(programTable[index], programs[index].getParams(), sizeof(programTable[index]));
+}
+
+void PluginProcessor::pullProgramEdits()
+{
+    for (eU32 word=0; word<TF_PLUG_NUM_PROGRAMS / 32; word++)
+    {
+        const eU32 bits = programTableEdited[word];
+        if (bits == 0)
+            continue;
+
+        for (eU32 bit=0; bit<32; bit++)
+        {
+            if (bits & (1u << bit))
+                programs[word * 32 + bit].setParams(programTable[word * 32 + bit]);
+        }
+
+        programTableEdited[word] = 0;
+    }
+}
+
 const String PluginProcessor::getProgramName (int index)
 {
     eASSERT(index >= 0 && index < TF_PLUG_NUM_PROGRAMS);
+    collectLoadedPrograms();
     return programs[index].getName();
 }
 
@@ -336,6 +616,7 @@ void PluginProcessor::setMasterVolume(float newValue)
 {
     // takes fader position 0..1
     masterGain.set(convertFaderToGain6dB(jlimit (0.0f, 1.0f, newValue)));
+    notifyEditor(MasterChanged);
 }
 
 float PluginProcessor::getMasterPan()
@@ -348,6 +629,7 @@ void PluginProcessor::setMasterPan(float newValue)
 {
     // takes fader position 0..1
     masterPan.set(jlimit (0.0f, 1.0f, newValue));
+    notifyEditor(MasterChanged);
 }
 
 void PluginProcessor::setMetering (bool on)
@@ -362,7 +644,26 @@ float PluginProcessor::getMeterLevel (int channel, int meter)
 
 void PluginProcessor::changeListenerCallback (ChangeBroadcaster* source)
 {
-    setCurrentProgram(requestedPreset.get());
+    if (source == programLoader)
+    {
+        collectLoadedPrograms();
+        return;
+    }
+
+    if (source == bankImporter)
+    {
+        collectImportedBank();
+        return;
+    }
+
+    // the audio thread switched programs on a MIDI program change
+    {
+        const SpinLock::ScopedLockType sl (programLock);
+        pullProgramEdits();
+    }
+
+    notifyEditor(ProgramChanged);
+    updateHostDisplay();
 }
 
 void PluginProcessor::processMidiVolume (int controllerValue)
@@ -382,7 +683,15 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     if (sampleRate > 0)
         synth->sampleRate = sampleRate;
     
+    impulseResponseLoader->setSampleRate(synth->sampleRate);
     setDelaysFromTempo();
+    updateTailLength();
+
+    // room for what a program change leaves over, so the
+    // audio thread doesn't allocate when it keeps events back
+    deferredEvents.clear();
+    deferredEvents.ensureSize(4096);
+    holdDeferredEvents = false;
 }
 
 void PluginProcessor::releaseResources()
@@ -398,8 +707,11 @@ void PluginProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiM
     MidiBuffer::Iterator it(midiMessages);
     MidiMessage midiMessage;
     eU32 messageOffset = 0;
+    eU32 eventOffset = 0;
     eU32 requestedLen = buffer.getNumSamples();
 
+    lastBlockTime.set(Time::getMillisecondCounter());
+
     eU32 sampleRate = static_cast<eU32>(getSampleRate());
     if (sampleRate > 0)
         synth->sampleRate = sampleRate;
@@ -409,96 +721,330 @@ void PluginProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiM
         buffer.clear(i, 0, buffer.getNumSamples());
     }
 
-    if (buffer.getNumChannels() == 2)
+    AudioSampleBuffer output = getBusBuffer(buffer, false, 0);
+
+    if (output.getNumChannels() == 2)
     {
         eU32 len = requestedLen;
-        eF32 **signal = buffer.getArrayOfWritePointers();
-        eF32 *destL = signal[0];
-        eF32 *destR = signal[1];
+        eU32 pos = 0;
 
         while(len)
         {
             if (!adapterDataAvailable)
             {
-                csSynth.enter();
                 eMemSet(adapterBuffer[0], 0, TF_BUFFERSIZE * sizeof(eF32));
                 eMemSet(adapterBuffer[1], 0, TF_BUFFERSIZE * sizeof(eF32));
-                processEvents(midiMessages, messageOffset, TF_BUFFERSIZE);
-                eTfInstrumentProcess(*synth, *tf, adapterBuffer, TF_BUFFERSIZE);
+
+                // parts stop where they are when multi-timbral mode goes off
+                partsRunning = multiTimbral.get() != 0;
+
+                // events a program change left over come first, except in the
+                // frame right after, which renders the events before the change
+                if (holdDeferredEvents)
+                    holdDeferredEvents = false;
+                else if (!deferredEvents.isEmpty())
+                {
+                    const eU32 first = deferredEvents.getFirstEventTime();
+                    const eU32 end = processEvents(deferredEvents, first, deferredEvents.getLastEventTime() + 1 - first);
+                    deferredEvents.clear(first, end - first);
+                    holdDeferredEvents = !deferredEvents.isEmpty();
+                }
+
+                if (deferredEvents.isEmpty())
+                    eventOffset = processEvents(midiMessages, eventOffset, messageOffset + TF_BUFFERSIZE - eventOffset);
+
+                if (pendingProgram >= 0 || partsRunning)
+                {
+                    const SpinLock::ScopedTryLockType sl (programLock);
+                    if (sl.isLocked())
+                    {
+                        if (pendingProgram >= 0)
+                        {
+                            switchProgram(pendingProgram);
+                            pendingProgram = -1;
+                            sendChangeMessage();
+                        }
+
+                        if (partsRunning)
+                            switchPartPrograms();
+                    }
+                }
+
+                parameters.apply(*tf);
+
+                // the other parts render on the worker pool while this
+                // thread renders the edited one. all are due a block from now.
+                const double blockTime = 1000.0 * TF_BUFFERSIZE / synth->sampleRate;
+                const double deadline = Time::getMillisecondCounterHiRes() + blockTime;
+
+                if (partsRunning)
+                {
+                    int activeCount = 0;
+                    for (SynthPart *part : parts)
+                    {
+                        if (part->active)
+                            activeParts[activeCount++] = part;
+                    }
+
+                    workerPool->submit(partBatch, &PluginProcessor::renderPart, this, activeCount, deadline);
+                }
+
+                const bool pipelined = pipelinedEffects.get() != 0;
+                if (pipelineRunning && !pipelined)
+                {
+                    // the block still in the chain is dropped, latency goes
+                    // back to zero and this thread renders the effects again
+                    effectChain->finish();
+                    pipelineRunning = false;
+                }
+
+                if (pipelined)
+                {
+                    eTfInstrumentProcessVoices(*synth, *tf, adapterBuffer, TF_BUFFERSIZE);
+                    // its effects are needed with the next block
+                    effectChain->process(adapterBuffer, deadline + blockTime);
+                    pipelineRunning = true;
+                }
+                else
+                    eTfInstrumentProcess(*synth, *tf, adapterBuffer, TF_BUFFERSIZE);
+
+                if (partsRunning)
+                {
+                    workerPool->wait(partBatch);
+
+                    // parts drop out of rendering once they have
+                    // faded out, until their next note comes in
+                    for (SynthPart *part : parts)
+                    {
+                        if (part->active && eTfInstrumentIsIdle(*part->instr))
+                            part->active = false;
+                    }
+                }
+
+                publishVoiceSnapshot();
+                if (waveformPreviewRequested.get() != 0 && waveformPreviewBusy.compareAndSetBool(1, 0))
+                {
+                    publishWaveformPreview(*tf, tf->latestTriggeredVoice);
+                    waveformPreviewBusy.set(0);
+                }
                 messageOffset += TF_BUFFERSIZE;
                 adapterDataAvailable = TF_BUFFERSIZE;
-                csSynth.exit();
             }
 
-            eF32 *srcL = &adapterBuffer[0][TF_BUFFERSIZE - adapterDataAvailable];
-            eF32 *srcR = &adapterBuffer[1][TF_BUFFERSIZE - adapterDataAvailable];
+            const eU32 count = eMin(len, adapterDataAvailable);
+            const eU32 src = TF_BUFFERSIZE - adapterDataAvailable;
 
-            while (len && adapterDataAvailable)
-            {
-                *destL++ += *srcL++;
-                *destR++ += *srcR++;
+            output.addFrom(0, pos, adapterBuffer[0] + src, count);
+            output.addFrom(1, pos, adapterBuffer[1] + src, count);
 
-                len--;
-                adapterDataAvailable--;
-            }
+            if (partsRunning)
+                mixParts(buffer, pos, src, count);
+
+            pos += count;
+            len -= count;
+            adapterDataAvailable -= count;
         }
     }
 
-    processEvents(midiMessages, messageOffset, requestedLen);
+    // the events after the last frame go to the next one, which may be
+    // rendered with the next block. those a program change leaves over
+    // are kept back, behind any that are waiting already.
+    if (!deferredEvents.isEmpty())
+        deferredEvents.addEvents(midiMessages, eventOffset, -1, deferredEvents.getLastEventTime() + 1 - (int)eventOffset);
+    else
+    {
+        const eU32 end = processEvents(midiMessages, eventOffset, requestedLen);
+        deferredEvents.addEvents(midiMessages, end, -1, -(int)end);
+        holdDeferredEvents = !deferredEvents.isEmpty();
+    }
 	midiMessages.clear();
+    updateTailLength();
     
-    // Master Volume & Pan, Metering
-    if (buffer.getNumChannels() == 2)
+    // Master Volume & Pan on every output, Metering
+    if (output.getNumChannels() == 2)
     {
         float masterPanL, masterPanR;
         convertFaderToPan(masterPan.get(), masterPanL, masterPanR);
-        buffer.applyGain (0, 0, requestedLen, masterGain.get() * masterPanL);
-        buffer.applyGain (1, 0, requestedLen, masterGain.get() * masterPanR);
+
+        for (int bus=0; bus<getBusCount(false); bus++)
+        {
+            if (getChannelCountOfBus(false, bus) != 2)
+                continue;
+
+            const int channel = getChannelIndexInProcessBlockBuffer(false, bus, 0);
+            buffer.applyGain (channel, 0, requestedLen, masterGain.get() * masterPanL);
+            buffer.applyGain (channel + 1, 0, requestedLen, masterGain.get() * masterPanR);
+        }
         
         if (metering.get())
         {
-            meterLevels[0].set (buffer.getMagnitude (0, 0, buffer.getNumSamples()));
-            meterLevels[1].set (buffer.getMagnitude (1, 0, buffer.getNumSamples()));
+            meterLevels[0].set (output.getMagnitude (0, 0, requestedLen));
+            meterLevels[1].set (output.getMagnitude (1, 0, requestedLen));
         }
     }
 }
 
-void PluginProcessor::processEvents (MidiBuffer &midiMessages, eU32 messageOffset, eU32 frameSize)
+// The host may ask for the tail from any thread, so it is worked
+// out here from the effect parameters of all parts and published.
+void PluginProcessor::updateTailLength()
+{
+    eTfEffectInput input;
+    eTfInstrumentGetEffectInput(*synth, *tf, input);
+    eF32 tail = eTfInstrumentGetTail(*synth, input);
+
+    if (partsRunning)
+    {
+        for (SynthPart *part : parts)
+        {
+            eTfInstrumentGetEffectInput(*synth, *part->instr, input);
+            tail = eMax(tail, eTfInstrumentGetTail(*synth, input));
+        }
+    }
+
+    // the pipelined chain hands its last block out one block later
+    if (pipelineRunning)
+        tail += (eF32)TF_BUFFERSIZE / synth->sampleRate;
+
+    tailLength.set(tail);
+}
+
+void PluginProcessor::publishVoiceSnapshot()
+{
+    VoiceSnapshot &snapshot = voiceSnapshot.back();
+    const eTfVoice *voice = tf->latestTriggeredVoice;
+
+    snapshot.playing = voice != nullptr && voice->playing;
+    if (snapshot.playing)
+        snapshot.modMatrix = voice->modMatrix;
+
+    voiceSnapshot.publish();
+}
+
+// the caller holds waveformPreviewBusy
+void PluginProcessor::publishWaveformPreview(eTfInstrument &instr, const eTfVoice *latest)
+{
+    // requests coming in from here on get the next one
+    waveformPreviewRequested.set(0);
+
+    // same as a voice generator, but over the full frequency range.
+    // the reset picks a random modulation phase each time, that's
+    // what makes the waveforms move.
+    if (latest != nullptr && latest->playing)
+    {
+        previewVoice->modMatrix = latest->modMatrix;
+        previewVoice->generator.modulation = latest->generator.modulation;
+    }
+
+    eTfVoiceReset(*previewVoice);
+    eTfGeneratorUpdate(*synth, instr, *previewVoice, previewVoice->generator, 1.0f);
+    eF32 *freqTable = previewVoice->generator.freqTable;
+
+    if (eTfGeneratorModulate(*synth, instr, *previewVoice, previewVoice->generator))
+        freqTable = previewVoice->generator.freqModTable;
+
+    WaveformPreview &preview = waveformPreview.back();
+    preview.generation = ++waveformPreviewGeneration;
+    preview.drive = instr.params[TF_GEN_DRIVE];
+    eMemCopy(preview.spectrum, freqTable, sizeof(preview.spectrum));
+
+    eTfGeneratorFft(*synth, IFFT, TF_IFFT_FRAMESIZE, freqTable);
+    eTfGeneratorNormalize(freqTable, TF_IFFT_FRAMESIZE);
+
+    for (eU32 i=0; i<TF_IFFT_FRAMESIZE; i++)
+        preview.waveform[i] = freqTable[i*2];
+
+    waveformPreview.publish();
+}
+
+// without audio the instrument's parameters are not kept up to date,
+// so this renders from the parameter store. no voice plays anyway.
+void PluginProcessor::publishIdleWaveformPreview()
+{
+    // the audio thread may have started again and be rendering one
+    if (!waveformPreviewBusy.compareAndSetBool(1, 0))
+        return;
+
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        previewInstr->params[i] = parameters.get(i);
+
+    publishWaveformPreview(*previewInstr, nullptr);
+    waveformPreviewBusy.set(0);
+}
+
+static bool isProgramSelection (const MidiMessage &midiMessage)
+{
+    return midiMessage.isProgramChange() || midiMessage.isControllerOfType(35);
+}
+
+// A frame is rendered with one program, so a program change after the
+// first sample ends the events of the frame. The change and the events
+// after it are left for the next frame. Returns where handling stopped.
+eU32 PluginProcessor::processEvents (MidiBuffer &midiMessages, eU32 messageOffset, eU32 frameSize)
 {
     MidiBuffer::Iterator it(midiMessages);
     MidiMessage midiMessage;
     int samplePosition;
+    eU32 frameEnd = messageOffset + frameSize;
 
     it.setNextSamplePosition(messageOffset);
 
     while (it.getNextEvent(midiMessage, samplePosition))
     {
-        if (samplePosition >= messageOffset + frameSize)
+        if ((eU32)samplePosition >= frameEnd)
+            break;
+
+        if ((eU32)samplePosition > messageOffset && isProgramSelection(midiMessage))
+        {
+            frameEnd = samplePosition;
             break;
+        }
+    }
+
+    it.setNextSamplePosition(messageOffset);
+
+    while (it.getNextEvent(midiMessage, samplePosition))
+    {
+        if ((eU32)samplePosition >= frameEnd)
+            break;
+
+        // in multi-timbral mode channels 2-16 play the other parts
+        const int channel = midiMessage.getChannel();
+        SynthPart *part = partsRunning && channel > 1 ? parts.getUnchecked(channel - 2) : nullptr;
+        eTfInstrument &instr = part ? *part->instr : *tf;
 
         if (midiMessage.isNoteOn())
         {
             eU8 velocity = static_cast<eU8>(midiMessage.getVelocity());
             eU8 note = static_cast<eU8>(midiMessage.getNoteNumber());
 
-            eTfInstrumentNoteOn(*tf, note, velocity);
+            eTfInstrumentNoteOn(instr, note, velocity);
+
+            if (part)
+                part->active = true;
         }
         else if (midiMessage.isNoteOff())
         {
             eU8 note = static_cast<eU8>(midiMessage.getNoteNumber());
 
-            eTfInstrumentNoteOff(*tf, note);
+            eTfInstrumentNoteOff(instr, note);
         }
         else if (midiMessage.isAllNotesOff())
         {
-            eTfInstrumentAllNotesOff(*tf);
+            eTfInstrumentAllNotesOff(instr);
         }
         else if (midiMessage.isControllerOfType(121))
         {   // Reset-All-Controllers
-            eTfInstrumentPitchBend(*tf,0,0);
-            processMidiVolume(FaderPosUnity * 127);
-            processMidiPan(64);
-            paramDirtyAny = true;
+            eTfInstrumentPitchBend(instr,0,0);
+            if (part)
+            {
+                part->volume.set(FaderPosUnity);
+                part->pan.set(0.5f);
+            }
+            else
+            {
+                processMidiVolume(FaderPosUnity * 127);
+                processMidiPan(64);
+            }
         }
         else if (midiMessage.isPitchWheel())
         {
@@ -508,59 +1054,74 @@ void PluginProcessor::processEvents (MidiBuffer &midiMessages, eU32 messageOffse
             auto semitones = ((eF32(bend_msb) / 127.0f) - 0.5f) * 2.0f;
             auto cents = ((eF32(bend_lsb) / 127.0f) - 0.5f) * 2.0f;
             
-            eTfInstrumentPitchBend(*tf, semitones, cents);
+            eTfInstrumentPitchBend(instr, semitones, cents);
         }
         else if (midiMessage.isTempoMetaEvent())
         {
             setDelaysFromTempo(1.0 / (midiMessage.getTempoSecondsPerQuarterNote() / 60.0));
-            paramDirtyAny = true;
         }
         else if (midiMessage.isControllerOfType(7))
         {
-            processMidiVolume(midiMessage.getControllerValue());
-            paramDirtyAny = true;
+            if (part)
+                part->volume.set(midiMessage.getControllerValue() / 127.0f);
+            else
+                processMidiVolume(midiMessage.getControllerValue());
         }
         else if (midiMessage.isControllerOfType(10))
         {
-            processMidiPan(midiMessage.getControllerValue());
-            paramDirtyAny = true;
+            if (part)
+                part->pan.set(midiMessage.getControllerValue() / 127.0f);
+            else
+                processMidiPan(midiMessage.getControllerValue());
         }
         else if (midiMessage.isControllerOfType(0))
         {
-            requestedBank_MSB = midiMessage.getControllerValue();
+            (part ? part->bankMSB : requestedBank_MSB) = midiMessage.getControllerValue();
         }
         else if (midiMessage.isControllerOfType(32))
         {
-            requestedBank_LSB = midiMessage.getControllerValue();
-        }
-        else if (midiMessage.isProgramChange())
-        {
-            requestedPreset.set(jmin((int)TF_PLUG_NUM_PROGRAMS-1,
-                                     (((requestedBank_MSB * 128) + requestedBank_LSB) * 128 + midiMessage.getProgramChangeNumber())));
-            sendChangeMessage();
+            (part ? part->bankLSB : requestedBank_LSB) = midiMessage.getControllerValue();
         }
-        else if (midiMessage.isControllerOfType(35))
-        {   // Alternative for Program Selection where only CC control is available
-            requestedPreset.set(jmin((int)TF_PLUG_NUM_PROGRAMS-1,
-                                     (((requestedBank_MSB * 128) + requestedBank_LSB) * 128 + midiMessage.getControllerValue())));
-            sendChangeMessage();
+        else if (isProgramSelection(midiMessage))
+        {   // switched in processBlock before the frame is rendered. CC 35 is an
+            // alternative for program selection where only CC control is available
+            const int number = midiMessage.isProgramChange() ? midiMessage.getProgramChangeNumber()
+                                                             : midiMessage.getControllerValue();
+            const int bankMSB = part ? part->bankMSB : requestedBank_MSB;
+            const int bankLSB = part ? part->bankLSB : requestedBank_LSB;
+            const int program = jmin((int)TF_PLUG_NUM_PROGRAMS-1, ((bankMSB * 128) + bankLSB) * 128 + number);
+
+            if (part)
+                part->pendingProgram.set(program);
+            else
+                pendingProgram = program;
         }
     }
+
+    return frameEnd;
 }
 
 
 void PluginProcessor::presetSave()
 {
-    programs[currentProgramIndex].loadFromSynth(tf);
-    privateSaveProgram(currentProgramIndex);
+    eU32 index;
+    {
+        const SpinLock::ScopedLockType sl (programLock);
+        index = currentProgramIndex.get();
+        programLoaded[index] = true;
+        programs[index].loadFromSynth(parameters);
+        pushProgram(index);
+    }
+    privateSaveProgram(index);
 }
 
 void PluginProcessor::presetCopy()
 {
     // copies current synth parameters w/o saving a preset yet
+    const SpinLock::ScopedLockType sl (programLock);
     clipboard = new eTfSynthProgram();
-    clipboard->setName(programs[currentProgramIndex].getName());
-    clipboard->loadFromSynth(tf);
+    clipboard->setName(programs[currentProgramIndex.get()].getName());
+    clipboard->loadFromSynth(parameters);
 }
 
 void PluginProcessor::presetPaste()
@@ -568,24 +1129,94 @@ void PluginProcessor::presetPaste()
     if (clipboard == nullptr)
         return;
     
-    programs[currentProgramIndex] = *clipboard;
-    programs[currentProgramIndex].setName(clipboard->getName());
-    programs[currentProgramIndex].applyToSynth(tf);
+    eU32 index;
+    {
+        const SpinLock::ScopedLockType sl (programLock);
+        index = currentProgramIndex.get();
+        programLoaded[index] = true;
+        programs[index] = *clipboard;
+        programs[index].setName(clipboard->getName());
+        programs[index].applyToSynth(parameters);
+        pushProgram(index);
+    }
     // paste is persistent: write through to disk
-    privateSaveProgram(currentProgramIndex);
-    resetParamDirty(true);
+    privateSaveProgram(index);
+    notifyEditor(ProgramChanged);
 }
 
 void PluginProcessor::presetRestore()
 {
-    // revert to last saved program
-    privateLoadProgram(currentProgramIndex);
-    programs[currentProgramIndex].applyToSynth(tf);
-    resetParamDirty(true);
+    // revert to last saved program, read from disk outside the lock
+    const eU32 index = currentProgramIndex.get();
+    programLoaded[index] = true;
+    privateLoadProgram(index);
+    {
+        const SpinLock::ScopedLockType sl (programLock);
+        pushProgram(index);
+        if ((int)index == currentProgramIndex.get())
+            programs[index].applyToSynth(parameters);
+    }
+    notifyEditor(ProgramChanged);
     updateHostDisplay();
 }
 
 
+void PluginProcessor::collectLoadedPrograms()
+{
+    if (programLoader == nullptr)
+        return;
+
+    const int count = programLoader->getNumLoaded();
+    if (programsCollected == count)
+        return;
+
+    for (; programsCollected < count; programsCollected++)
+    {
+        const int index = programsCollected;
+        if (programLoaded[index])
+            continue;
+
+        programs[index] = programLoader->getProgram(index);
+        programLoaded[index] = true;
+
+        {
+            const SpinLock::ScopedLockType sl (programLock);
+            pushProgram(index);
+            // a MIDI program change may have selected it before
+            if (index == currentProgramIndex.get())
+            {
+                programs[index].applyToSynth(parameters);
+                notifyEditor(ProgramChanged);
+            }
+        }
+
+        // parts playing it switch again, unless they're about to anyway
+        for (SynthPart *part : parts)
+        {
+            if (part->program.get() == index)
+                part->pendingProgram.compareAndSetBool(index, -1);
+        }
+
+        // move old Tunefish4 files to the new bank folders
+        if (programLoader->isLegacy(index))
+            privateSaveProgram(index, programLoader->getFile(index));
+    }
+
+    updateHostDisplay();
+}
+
+void PluginProcessor::ensureProgramLoaded (eU32 index)
+{
+    if (programLoaded[index])
+        return;
+
+    programLoaded[index] = true;
+    privateLoadProgram(index);
+
+    const SpinLock::ScopedLockType sl (programLock);
+    pushProgram(index);
+}
+
 bool PluginProcessor::privateLoadProgram (eU32 index)
 {
     // For backwards compatibility, look for old Tunefish4 files first
@@ -613,55 +1244,28 @@ bool PluginProcessor::privateLoadProgram (eU32 index)
     if (!file.existsAsFile())
         return false;
     
-    ScopedPointer<FileInputStream> stream = file.createInputStream();
-    if (stream == nullptr)
+    DBG ("Loading " << file.getFullPathName());
+    programs[index].loadDefault(index);
+    if (!programs[index].loadFromFile(file))
     {
         NativeMessageBox::showMessageBox(AlertWindow::AlertIconType::WarningIcon,
                                          "Error",
                                          "Failed opening " + file.getFullPathName());
         return false;
     }
-    DBG ("Loading " << file.getFullPathName());
-    programs[index].loadDefault(index);
-    programs[index].setName(stream->readNextLine());
     
-    while(true)
-    {
-        String line = stream->readNextLine();
-        if (line.length() == 0)
-            break;
-        
-        StringArray parts;
-        parts.addTokens(line, ";", "");
-        if (parts.size() == 2)
-        {
-            String key = parts[0];
-            eF32 value = parts[1].getFloatValue();
-            
-            for(eU32 i=0;i<TF_PARAM_COUNT;i++)
-            {
-                if (key == TF_NAMES[i])
-                {
-                    programs[index].setParam(i, value);
-                    break;
-                }
-            }
-        }
-    }
-    
-    // Get rid of the imported file and save in new structure
+    // Get rid of the imported file and save in new structure,
+    // it is deleted once the new one is safely written
     if (imported)
     {
-        stream = nullptr;
-        if (privateSaveProgram(index))
-            file.deleteFile();
+        privateSaveProgram(index, file);
         DBG("   migrated to: " << file.getFullPathName());
     }
     return true;
 }
 
 
-bool PluginProcessor::privateSaveProgram (eU32 index)
+bool PluginProcessor::privateSaveProgram (eU32 index, const File &obsolete)
 {
     // Files are saved in shared users directory, preserving the factory presets
     const int bank = index / 128;
@@ -671,56 +1275,91 @@ bool PluginProcessor::privateSaveProgram (eU32 index)
         String("bank") + String(bank) + File::getSeparatorString() +
         String("program") + String(prog).paddedLeft('0',3) + String(".txt"));
 
-    file.getParentDirectory().createDirectory();
-    file.deleteFile();
-    ScopedPointer<FileOutputStream> stream = file.createOutputStream();
-    if (stream == nullptr)
-    {
-        NativeMessageBox::showMessageBox(AlertWindow::AlertIconType::WarningIcon,
-                                         "Error",
-                                         "Failed writing " + file.getFullPathName());
-        return false;
-    }
     DBG ("Saving " << file.getFullPathName());
-    stream->writeText(programs[index].getName(), false, false, nullptr);
-    stream->writeText("\r\n", false, false, nullptr);
+    programWriter->write(file, programs[index].toText(), obsolete);
+    return true;
+}
+
+void PluginProcessor::bankExport (const File &folder)
+{
+    const eU32 first = currentProgramIndex.get() / 128 * 128;
+    Array<File> files;
+    StringArray texts;
 
-    for(eU32 i=0; i<TF_PARAM_COUNT; i++)
+    collectLoadedPrograms();
     {
-        stream->writeText(TF_NAMES[i], false, false, nullptr);
-        stream->writeText(";", false, false, nullptr);
-        stream->writeText(String(programs[index].getParam(i)), false, false, nullptr);
-        stream->writeText("\r\n", false, false, nullptr);
+        const SpinLock::ScopedLockType sl (programLock);
+        pullProgramEdits();
     }
-    return true;
-}
 
+    for (eU32 prog=0; prog<128; prog++)
+    {
+        ensureProgramLoaded(first + prog);
+        files.add(folder.getChildFile(String("program") + String(prog).paddedLeft('0',3) + String(".txt")));
+        texts.add(programs[first + prog].toText());
+    }
 
+    programWriter->write(files, texts);
+}
 
-bool PluginProcessor::isParamDirtyAny()
+void PluginProcessor::bankImport (const File &folder)
 {
-    return paramDirtyAny;
+    // replaces the programs of the current bank that have a file in
+    // folder. the files are read in the background, an import still
+    // running is dropped.
+    bankImporter = nullptr;
+    bankImporter = new BankImporter(folder, currentProgramIndex.get() / 128 * 128);
+    bankImporter->addChangeListener(this);
+    bankImporter->startThread();
 }
 
-bool PluginProcessor::isParamDirty(eU32 index)
+void PluginProcessor::collectImportedBank()
 {
-    return paramDirty[index];
+    // takes over what the importer read and saves it to
+    // the user bank in one background job
+    const eU32 first = bankImporter->getFirst();
+    Array<File> files;
+    StringArray texts;
+
+    for (eU32 prog=0; prog<eTfProgramBank::PROGRAMS; prog++)
+    {
+        if (!bankImporter->isFound(prog))
+            continue;
+
+        const eTfSynthProgram &program = bankImporter->getProgram(prog);
+
+        {
+            const SpinLock::ScopedLockType sl (programLock);
+            programs[first + prog] = program;
+            programLoaded[first + prog] = true;
+            pushProgram(first + prog);
+            if ((int)(first + prog) == currentProgramIndex.get())
+                programs[first + prog].applyToSynth(parameters);
+        }
+
+        files.add(presetsDirectory(false).getChildFile(String("bank") + String(first / 128)).getChildFile(BankImporter::fileName(prog)));
+        texts.add(program.toText());
+    }
+
+    programWriter->write(files, texts);
+    notifyEditor(ProgramChanged);
+    updateHostDisplay();
 }
 
-bool PluginProcessor::wasProgramSwitched() const
+
+
+int PluginProcessor::collectEditorChanges(eTfParameterStore::Changes &changes)
 {
-    return programSwitched;
+    parameters.collectUiChanges(changes);
+
+    if (editorChanges.load(std::memory_order_relaxed) == 0)
+        return 0;
+    return editorChanges.exchange(0, std::memory_order_acquire);
 }
 
-void PluginProcessor::resetParamDirty(eBool dirty)
+void PluginProcessor::notifyEditor(int changes)
 {
-    for (eU32 j = 0; j<TF_PARAM_COUNT; j++)
-    {
-        paramDirty[j] = dirty;
-    }
-
-    programSwitched = dirty;
-    paramDirtyAny = dirty;
+    editorChanges.fetch_or(changes, std::memory_order_release);
 }
 
 //==============================================================================
@@ -735,21 +1374,177 @@ AudioProcessorEditor* PluginProcessor::createEditor()
 }
 
 //==============================================================================
+/**
+ Host state is a compact binary chunk rather than XML, so sessions with many
+ instances save and restore quickly:
+
+    int32   magic 'SPST', int32 version
+    float   master volume, float master pan
+    byte    pipelined effects, UTF-8 string impulse response path
+    byte    multi-timbral mode (version 2)
+    int32   part count, then per part:
+            int32 size of the rest of the part in bytes
+            int32 parameter count, then (int32 parameter ID, float value) pairs
+            int32 program, float volume, float pan (version 2)
+
+ Parameters are stored under eTfSynthProgram::paramId(), so unknown IDs from
+ newer versions are skipped. Parts are sized so a reader can skip what it
+ does not know about. Only the first part stores parameters, the others play
+ their program as is. The program of the first part is the current program,
+ it is selected again without loading it over the stored parameters. Chunks
+ saved by older versions as XML are still read.
+ */
+
+static const int StateChunkMagic   = (int)ByteOrder::littleEndianInt("SPST");
+static const int StateChunkVersion = 2;
+
 void PluginProcessor::getStateInformation (MemoryBlock& destData)
 {
-    XmlElement xml ("SYNTH-PARAMETERS");
+    destData.reset();
+    MemoryOutputStream stream (destData, false);
+
+    stream.writeInt(StateChunkMagic);
+    stream.writeInt(StateChunkVersion);
+    stream.writeFloat(getMasterVolume());
+    stream.writeFloat(getMasterPan());
+    stream.writeBool(isPipelinedEffects());
+    stream.writeString(getImpulseResponseFile().getFullPathName());
+    stream.writeBool(isMultiTimbral());
+
+    const int partInfoSize = sizeof(int) + 2 * sizeof(float);
+
+    stream.writeInt(1 + parts.size());
+    stream.writeInt(sizeof(int) + TF_PARAM_COUNT * (sizeof(int) + sizeof(float)) + partInfoSize);
+    stream.writeInt(TF_PARAM_COUNT);
 
     for (eU32 i=0; i<TF_PARAM_COUNT; i++)
     {
-        xml.setAttribute (TF_NAMES[i], tf->params[i]);
+        stream.writeInt((int)eTfSynthProgram::paramId(i));
+        stream.writeFloat(parameters.get(i));
+    }
+
+    // the first part follows the master volume and pan
+    stream.writeInt(getCurrentProgram());
+    stream.writeFloat(FaderPosUnity);
+    stream.writeFloat(0.5f);
+
+    for (const SynthPart *part : parts)
+    {
+        stream.writeInt(sizeof(int) + partInfoSize);
+        stream.writeInt(0);
+        stream.writeInt(part->program.get());
+        stream.writeFloat(part->volume.get());
+        stream.writeFloat(part->pan.get());
     }
-    xml.setAttribute ("MasterVolume", getMasterVolume());
-    xml.setAttribute ("MasterPan", getMasterPan());
-    copyXmlToBinary (xml, destData);
+}
+
+bool PluginProcessor::readStateChunk (const void* data, int sizeInBytes)
+{
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+
+    if (sizeInBytes < 2 * (int)sizeof(int) || stream.readInt() != StateChunkMagic)
+        return false;
+
+    const int version = stream.readInt();
+    if (version > StateChunkVersion)
+        return false;
+
+    const float volume = stream.readFloat();
+    const float pan = stream.readFloat();
+    const bool pipelined = stream.readBool();
+    const String impulseResponse = stream.readString();
+    const bool multi = version >= 2 && stream.readBool();
+    const int partInfoSize = sizeof(int) + 2 * sizeof(float);
+    const int partCount = stream.readInt();
+
+    if (stream.isExhausted() || partCount < 1)
+        return false;
+
+    // parts are saved once created, also with multi-timbral mode
+    // switched off again, and keep their settings for when it's back
+    if (partCount > 1 && parts.isEmpty())
+        createParts();
+
+    int currentProgram = -1;
+
+    for (int index=0; index<partCount; index++)
+    {
+        const int partSize = stream.readInt();
+        const int64 partEnd = stream.getPosition() + partSize;
+        const int count = stream.readInt();
+
+        if (partSize < (int)sizeof(int) || partEnd > sizeInBytes || count < 0 ||
+            count > (partSize - (int)sizeof(int)) / (int)(sizeof(int) + sizeof(float)))
+        {
+            if (index == 0)
+                return false;
+            break;
+        }
+
+        if (index == 0)
+        {
+            const SpinLock::ScopedLockType sl (programLock);
+            for (int i=0; i<count; i++)
+            {
+                const int param = eTfSynthProgram::findParamById((eU32)stream.readInt());
+                const float value = stream.readFloat();
+
+                if (param >= 0)
+                    parameters.set(param, value);
+            }
+
+            // the parameters stay as saved, they may hold unsaved edits
+            if (version >= 2 && partSize >= (int)sizeof(int) + count * (int)(sizeof(int) + sizeof(float)) + partInfoSize)
+                currentProgram = stream.readInt();
+        }
+        else if (version >= 2 && index <= parts.size() &&
+                 partSize >= (int)sizeof(int) + count * (int)(sizeof(int) + sizeof(float)) + partInfoSize)
+        {
+            stream.skipNextBytes(count * (sizeof(int) + sizeof(float)));
+
+            SynthPart *part = parts.getUnchecked(index - 1);
+            const int program = stream.readInt();
+            part->volume.set(stream.readFloat());
+            part->pan.set(stream.readFloat());
+
+            if (program >= 0 && program < (int)TF_PLUG_NUM_PROGRAMS)
+            {
+                ensureProgramLoaded(program);
+                part->program.set(program);
+                part->pendingProgram.set(program);
+            }
+        }
+
+        stream.setPosition(partEnd);
+    }
+
+    if (currentProgram >= 0 && currentProgram < (int)TF_PLUG_NUM_PROGRAMS)
+    {
+        ensureProgramLoaded(currentProgram);
+        {
+            const SpinLock::ScopedLockType sl (programLock);
+            currentProgramIndex.set(currentProgram);
+        }
+        notifyEditor(ProgramChanged);
+        updateHostDisplay();
+    }
+
+    setMasterVolume(volume);
+    setMasterPan(pan);
+    setPipelinedEffects(pipelined);
+    setMultiTimbral(multi);
+
+    if (impulseResponse.isNotEmpty())
+        loadImpulseResponse(File(impulseResponse));
+
+    return true;
 }
 
 void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    if (readStateChunk(data, sizeInBytes))
+        return;
+
     std::unique_ptr<XmlElement> xmlState = getXmlFromBinary (data, sizeInBytes);
 
     if (xmlState != nullptr)
@@ -757,12 +1552,20 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
         // make sure that it's actually our type of XML object..
         if (xmlState->hasTagName ("SYNTH-PARAMETERS"))
         {
-            for (eU32 i=0; i<TF_PARAM_COUNT; i++)
             {
-                tf->params[i] = static_cast<float>(xmlState->getDoubleAttribute (TF_NAMES[i], tf->params[i]));
+                const SpinLock::ScopedLockType sl (programLock);
+                for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+                {
+                    parameters.set(i, static_cast<float>(xmlState->getDoubleAttribute (TF_NAMES[i], parameters.get(i))));
+                }
             }
             setMasterVolume(static_cast<float>(xmlState->getDoubleAttribute("MasterVolume", FaderPosUnity)));
             setMasterPan(static_cast<float>(xmlState->getDoubleAttribute("MasterPan", 0.5)));
+            setPipelinedEffects(xmlState->getBoolAttribute("PipelinedEffects", false));
+
+            const String impulseResponse = xmlState->getStringAttribute("ImpulseResponse");
+            if (impulseResponse.isNotEmpty())
+                loadImpulseResponse(File(impulseResponse));
         }
     }
 }
@@ -774,7 +1577,3 @@ AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new PluginProcessor();
 }
 
-CriticalSection & PluginProcessor::getSynthCriticalSection()
-{
-    return csSynth;
-}
@@ -34,11 +34,43 @@
 #include "tflookandfeel.h"
 #include "runtime/system.hpp"
 #include "tfsynthprogram.hpp"
+#include "tfparameterstore.hpp"
+#include "tfprogrambank.hpp"
+#include "tfworkerpool.hpp"
+#include "tfeffectpoolthread.hpp"
+#include "tfeffectchain.hpp"
+#include "tfimpulseresponseloader.hpp"
+#include "tfprogramloader.hpp"
+#include "tfprogramwriter.hpp"
+#include "runtime/lockfree.hpp"
 #include "synth/tf4.hpp"
 
-const eU32 TF_PLUG_NUM_PROGRAMS = 1024;
+const eU32 TF_PLUG_NUM_PARTS    = 16;
 
 
+/**
+ A part of the multi-timbral mode. Part 0 is the instrument shown in the
+ editor, the others each play a program on their own MIDI channel. All
+ parts share the synth's tables.
+ */
+
+struct SynthPart
+{
+    eTfInstrument *         instr;
+    eTfEffectPool           effectPool;
+    eF32 *                  buffer[2];
+
+    // audio thread only
+    int                     bankMSB;
+    int                     bankLSB;
+    bool                    active;
+
+    Atomic<int>             program;
+    Atomic<int>             pendingProgram;
+    Atomic<float>           volume;     // fader positions
+    Atomic<float>           pan;
+};
+
 
 class PluginProcessor  :
     public AudioProcessor,
@@ -54,7 +86,7 @@ public:
     void                    releaseResources() override;
 
     void                    processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages) override;
-    void                    processEvents(MidiBuffer &midiMessages, eU32 messageOffset, eU32 frameSize);
+    eU32                    processEvents(MidiBuffer &midiMessages, eU32 messageOffset, eU32 frameSize);
 
 
     AudioProcessorEditor*   createEditor() override;
@@ -67,6 +99,31 @@ public:
 
     float                   getParameterMod(int index);
 
+    // Modulation state of the latest triggered voice, as
+    // published by the audio thread. Message thread only.
+    struct VoiceSnapshot
+    {
+        eTfModMatrix        modMatrix;
+        bool                playing;
+    };
+
+    const VoiceSnapshot &   getVoiceSnapshot();
+
+    // Generator spectrum and waveform of the latest triggered voice.
+    // The audio thread renders one on request and bumps generation,
+    // a thread of its own does while the host processes no audio.
+    struct WaveformPreview
+    {
+        eU32                generation;
+        eF32                drive;
+        eF32                spectrum[TF_IFFT_FRAMESIZE];
+        eF32                waveform[TF_IFFT_FRAMESIZE];
+    };
+
+    // Message thread only
+    const WaveformPreview & getWaveformPreview();
+    void                    requestWaveformPreview();
+
     float                   getParameter (int index) override;
     void                    setParameter (int index, float newValue) override;
 
@@ -89,8 +146,6 @@ public:
     const String            getProgramName (int index) override;
     void                    changeProgramName (int index, const String& newName) override;
 
-    CriticalSection &       getSynthCriticalSection();
-
     void                    getStateInformation (MemoryBlock& destData) override;
     void                    setStateInformation (const void* data, int sizeInBytes) override;
 
@@ -99,14 +154,34 @@ public:
     void                    presetCopy();
     void                    presetPaste();
     void                    presetRestore();
+    void                    bankExport(const File &folder);
+    void                    bankImport(const File &folder);
+
+    // What else the editor has to refresh besides parameters
+    enum EditorChange
+    {
+        ProgramChanged  = 1,
+        MasterChanged   = 2
+    };
 
-    bool                    isParamDirty(eU32 index);
-    bool                    isParamDirtyAny();
-    void                    resetParamDirty(eBool dirty = eFALSE);
-    bool                    wasProgramSwitched() const;
+    // Message thread only. Adds the parameters changed since the last
+    // call to changes and returns the EditorChange flags raised since.
+    int                     collectEditorChanges(eTfParameterStore::Changes &changes);
     
     void                    setDelaysFromTempo(double bpm = 0);
     
+    bool                    isPipelinedEffects() const;
+    void                    setPipelinedEffects(bool on);
+
+    // MIDI channels 2-16 play parts of their own, channel 1
+    // plays the edited program. Otherwise all channels do.
+    bool                    isMultiTimbral() const;
+    void                    setMultiTimbral(bool on);
+    bool                    isBusesLayoutSupported (const BusesLayout& layouts) const override;
+    
+    File                    getImpulseResponseFile() const;
+    void                    loadImpulseResponse(const File &file);
+    
     MidiKeyboardState       keyboardState;
     
     float                   getMasterVolume();
@@ -118,26 +193,98 @@ public:
     
 private:
     //==============================================================================
+
+    class WaveformPreviewThread : public Thread
+    {
+    public:
+        WaveformPreviewThread (PluginProcessor &p) : Thread ("Sprike Preview"), processor (p) {}
+
+        void run() override;
+
+    private:
+        PluginProcessor &   processor;
+    };
     
     bool                    privateLoadProgram(eU32 index);
-    bool                    privateSaveProgram(eU32 index);
+    bool                    privateSaveProgram(eU32 index, const File &obsolete = File());
+    void                    publishVoiceSnapshot();
+    void                    publishWaveformPreview(eTfInstrument &instr, const eTfVoice *latest);
+    void                    publishIdleWaveformPreview();
+    void                    updateTailLength();
+    bool                    readStateChunk(const void* data, int sizeInBytes);
+    void                    notifyEditor(int changes);
+
+    // programLock must be held for these
+    void                    switchProgram(int index);
+    void                    pushProgram(eU32 index);
+    void                    pullProgramEdits();
+
+    void                    collectLoadedPrograms();
+    void                    collectImportedBank();
+    void                    ensureProgramLoaded(eU32 index);
+
+    void                    createParts();
+    void                    mixParts(AudioSampleBuffer &buffer, eU32 offset, eU32 srcOffset, eU32 len);
+    void                    switchPartPrograms();
+    static void             renderPart(void *context, eU32 index);
 
     eTfInstrument *         tf;
     eTfSynth *              synth;
+    eTfParameterStore       parameters;
+    eTripleBuffer<VoiceSnapshot> voiceSnapshot;
+    eTripleBuffer<WaveformPreview> waveformPreview;
+    Atomic<int>             waveformPreviewRequested;
+    Atomic<int>             waveformPreviewBusy;         // held by whoever renders one
+    Atomic<uint32>          lastBlockTime;               // ms, when processBlock last ran
+    eU32                    waveformPreviewGeneration;   // with waveformPreviewBusy only
+    eTfVoice *              previewVoice;                // with waveformPreviewBusy only
+    eTfInstrument *         previewInstr;                // preview thread only, params only
+    ScopedPointer<WaveformPreviewThread> waveformPreviewThread;
+    SharedResourcePointer<eTfWorkerPool> workerPool;
+    eTfEffectPool           effectPool;
+    ScopedPointer<EffectPoolThread> effectPoolThread;
+    ScopedPointer<EffectChain> effectChain;
+    Atomic<int>             pipelinedEffects;
+    bool                    pipelineRunning;
+
+    // parts 2-16, created when multi-timbral mode is first
+    // switched on and kept until the processor goes away
+    OwnedArray<SynthPart>   parts;
+    Atomic<int>             multiTimbral;
+    bool                    partsRunning;
+    SynthPart *             activeParts[TF_PLUG_NUM_PARTS];
+    eTfWorkerPool::Batch    partBatch;
+    eTfConvolutionIrExchange convolutionIr;
+    ScopedPointer<ImpulseResponseLoader> impulseResponseLoader;
     eTfSynthProgram         programs[TF_PLUG_NUM_PROGRAMS]; 
-    eBool                   paramDirty[TF_PARAM_COUNT];
-    eBool                   paramDirtyAny;
-    eBool                   programSwitched;
-    eU32                    currentProgramIndex;
+    std::atomic<int>        editorChanges;
+    Atomic<int>             currentProgramIndex;
+
+    // Dense copies of all programs, so the audio thread can switch
+    // programs itself. It only ever tries to take programLock and
+    // retries on the next block if the message thread holds it.
+    SpinLock                programLock;
+    eF32                    programTable[TF_PLUG_NUM_PROGRAMS][TF_PARAM_COUNT];
+    eU32                    programTableEdited[TF_PLUG_NUM_PROGRAMS / 32];
+    int                     pendingProgram;
+
+    ScopedPointer<ProgramLoader> programLoader;
+    ScopedPointer<BankImporter> bankImporter;
+    ScopedPointer<ProgramWriter> programWriter;
+    bool                    programLoaded[TF_PLUG_NUM_PROGRAMS];
+    int                     programsCollected;
 
     ScopedPointer<eTfSynthProgram> currentProgram;
     ScopedPointer<eTfSynthProgram> clipboard;
     
-    CriticalSection         csSynth;
-
     eF32 *                  adapterBuffer[2];
     eU32                    adapterWriteOffset;
     eU32                    adapterDataAvailable;
+
+    // Events after a program change, kept back for the frame after the
+    // one that renders the events before it. Held while that is to come.
+    MidiBuffer              deferredEvents;
+    bool                    holdDeferredEvents;
     
     void                    processMidiPan(int controllerValue);
     void                    processMidiVolume(int controllerValue);
@@ -149,9 +296,9 @@ private:
     Atomic<float>           masterPan;
     int                     requestedBank_MSB;
     int                     requestedBank_LSB;
-    Atomic<int>             requestedPreset;
     Atomic<float>           meterLevels[2];
     Atomic<int>             metering;
+    Atomic<float>           tailLength;     // seconds, set by the audio thread
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 };
@@ -0,0 +1,123 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef LOCKFREE_HPP
+#define LOCKFREE_HPP
+
+#include <atomic>
+
+// bounded single-producer/single-consumer queue. push()
+// is only called by one thread and pop() by one other
+// thread, neither of them ever blocks or allocates, so
+// it's safe to use from the audio callback.
+template<class T, eU32 CAPACITY> class eLockFreeQueue
+{
+    static_assert((CAPACITY & (CAPACITY-1)) == 0, "capacity must be a power of 2");
+
+public:
+    eLockFreeQueue() : m_head(0), m_tail(0)
+    {
+    }
+
+    eBool push(const T &item)
+    {
+        const eU32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+            return eFALSE;
+
+        m_items[tail & (CAPACITY-1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return eTRUE;
+    }
+
+    eBool pop(T &item)
+    {
+        const eU32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return eFALSE;
+
+        item = m_items[head & (CAPACITY-1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return eTRUE;
+    }
+
+    eBool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T                   m_items[CAPACITY];
+    std::atomic<eU32>   m_head;
+    std::atomic<eU32>   m_tail;
+};
+
+// triple buffer for publishing snapshots of some state from
+// one thread to one other thread. the writer fills back() and
+// publishes it, the reader gets the most recent complete
+// snapshot from read(). neither side ever waits.
+template<class T> class eTripleBuffer
+{
+public:
+    eTripleBuffer() : m_buffers(), m_back(0), m_front(1), m_middle(2)
+    {
+    }
+
+    // writer only
+    T & back()
+    {
+        return m_buffers[m_back];
+    }
+
+    // writer only
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader only
+    const T & read()
+    {
+        if (m_middle.load(std::memory_order_relaxed) & FRESH)
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+
+        return m_buffers[m_front];
+    }
+
+private:
+    enum
+    {
+        INDEX = 3,
+        FRESH = 4
+    };
+
+    T                   m_buffers[3];
+    eU32                m_back;
+    eU32                m_front;
+    std::atomic<eU32>   m_middle;
+};
+
+#endif
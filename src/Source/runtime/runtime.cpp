@@ -413,6 +413,23 @@ eU32 eRoundToMultiple(eU32 x, eU32 multiple)
     return (!remainder ? x : x+multiple-remainder);
 }
 
+// smallest power of 2 >= x
+eU32 eNextPowerOf2(eU32 x)
+{
+    x--;
+    x |= x>>1;
+    x |= x>>2;
+    x |= x>>4;
+    x |= x>>8;
+    x |= x>>16;
+    return x+1;
+}
+
+eBool eIsPowerOf2(eU32 x)
+{
+    return (x && !(x&(x-1)));
+}
+
 eBool eIsNumber(eF32 x)
 {
    return (!eIsNan(x)) && (x <= eF32_MAX && x >= -eF32_MAX);
@@ -557,4 +574,34 @@ eU32 eHashStr(const eChar *str)
     return hash;
 }
 
+// standard CRC-32 (IEEE 802.3). pass the result of
+// a previous call as crc to continue a checksum.
+eU32 eCrc32(eConstPtr data, eU32 size, eU32 crc)
+{
+    struct Table
+    {
+        Table()
+        {
+            for (eU32 i=0; i<256; i++)
+            {
+                eU32 c = i;
+                for (eU32 k=0; k<8; k++)
+                    c = (c & 1) ? 0xedb88320 ^ (c >> 1) : (c >> 1);
+                entries[i] = c;
+            }
+        }
+
+        eU32 entries[256];
+    };
+
+    static const Table table;
+    const eU8 *bytes = (const eU8 *)data;
+
+    crc = ~crc;
+    while (size--)
+        crc = table.entries[(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
 
@@ -110,6 +110,7 @@ eF32    eRadToDeg(eF32 radians);
 eBool   eIsAligned(eConstPtr data, eU32 alignment);
 eU32    eHashInt(eInt key);
 eU32    eHashStr(const eChar *str);
+eU32    eCrc32(eConstPtr data, eU32 size, eU32 crc=0);
 eU32    eNextPowerOf2(eU32 x);
 eBool   eIsPowerOf2(eU32 x);
 eU32    eBzr(eU32 x);
@@ -289,6 +290,39 @@ template<class T> void eMemZero(T &val)
     eMemSet(&val, 0, sizeof(T));
 }
 
+// compile-time sine and exponential for generating lookup tables.
+// written as single return statements to keep older compilers happy.
+// far too slow to call at run time, use eSin() and eExp() there.
+
+constexpr eF64 _eConstSinSeries(eF64 x2, eF64 term, eU32 n)
+{
+    return n > 18 ? term : term + _eConstSinSeries(x2, -term * x2 / ((2*n) * (2*n+1)), n+1);
+}
+
+constexpr eF64 _eConstExpSeries(eF64 x, eF64 term, eU32 n)
+{
+    return n > 16 ? term : term + _eConstExpSeries(x, term * x / n, n+1);
+}
+
+constexpr eF64 _eConstPow16(eF64 x)
+{
+    return (x*x)*(x*x)*(x*x)*(x*x)*(x*x)*(x*x)*(x*x)*(x*x);
+}
+
+// reduces x to [-pi, pi] first, accurate for |x| < a few 2*pi
+constexpr eF64 eConstSin(eF64 x)
+{
+    return x > 3.14159265358979323846 ? eConstSin(x - 6.28318530717958647692) :
+           x < -3.14159265358979323846 ? eConstSin(x + 6.28318530717958647692) :
+           _eConstSinSeries(x*x, x, 1);
+}
+
+// exp(x/16)^16, accurate for |x| < about 10
+constexpr eF64 eConstExp(eF64 x)
+{
+    return _eConstPow16(_eConstExpSeries(x / 16.0, 1.0, 1));
+}
+
 template<class MEMBER, class PARENT>
 PARENT & eGetContainerOf(MEMBER &memberInst, const MEMBER PARENT::*memberVar)
 {
@@ -52,7 +52,7 @@
 #define eSimdSqrt(v)                                _mm_sqrt_ps(v)
 #define eSimdMax(v0, v1)                            _mm_max_ps(v0, v1)
 #define eSimdMin(v0, v1)                            _mm_min_ps(v0, v1)
-#define eSimdAbs(v)                                 _mm_andnot_ps(v, _mm_castsi128_ps(_mm_set1_epi32(eSIMD_MSB1_REST0)))
+#define eSimdAbs(v)                                 _mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32(eSIMD_MSB1_REST0)), v)
 #define eSimdNeg(v)                                 _mm_xor_ps(v, _mm_castsi128_ps(_mm_set1_epi32(eSIMD_MSB1_REST0)))
 #define eSimdXor(v0, v1)                            _mm_xor_ps(v0, v1)
 #define eSimdStore(v, buf)                          _mm_storeu_ps(buf, v)
@@ -78,6 +78,55 @@
 typedef __m128 eF32x2;
 typedef __m128 eF32x4;
 
+// log2(x) for x > 0, polynomial approximation with
+// an absolute error below 2e-5 (after J. Fonseca)
+eFORCEINLINE eF32x4 eSimdLog2(eF32x4 x)
+{
+    const __m128i bits = _mm_castps_si128(x);
+    const __m128i exp = _mm_sub_epi32(_mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7f800000)), 23), _mm_set1_epi32(127));
+    const eF32x4 mant = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff))), _mm_set1_ps(1.0f));
+
+    eF32x4 p = _mm_set1_ps(-3.4436006e-2f);
+    p = eSimdFma(_mm_set1_ps(3.1821337e-1f), p, mant);
+    p = eSimdFma(_mm_set1_ps(-1.2315303f), p, mant);
+    p = eSimdFma(_mm_set1_ps(2.5988452f), p, mant);
+    p = eSimdFma(_mm_set1_ps(-3.3241990f), p, mant);
+    p = eSimdFma(_mm_set1_ps(3.1157899f), p, mant);
+
+    return eSimdFma(_mm_cvtepi32_ps(exp), p, eSimdSubScalar(mant, 1.0f));
+}
+
+// 2^x for -126 <= x <= 127, polynomial approximation
+// with a relative error below 2e-7 (after J. Fonseca)
+eFORCEINLINE eF32x4 eSimdExp2(eF32x4 x)
+{
+    x = eSimdMin(eSimdMax(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.0f));
+
+    // floor with SSE2 only: truncate, then step down
+    // where truncation rounded a negative x upwards
+    const eF32x4 trunc = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    const eF32x4 ipart = eSimdSub(trunc, _mm_and_ps(_mm_cmpgt_ps(trunc, x), _mm_set1_ps(1.0f)));
+    const eF32x4 fpart = eSimdSub(x, ipart);
+    const eF32x4 expipart = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(ipart), _mm_set1_epi32(127)), 23));
+
+    eF32x4 p = _mm_set1_ps(1.8775767e-3f);
+    p = eSimdFma(_mm_set1_ps(8.9893397e-3f), p, fpart);
+    p = eSimdFma(_mm_set1_ps(5.5826318e-2f), p, fpart);
+    p = eSimdFma(_mm_set1_ps(2.4015361e-1f), p, fpart);
+    p = eSimdFma(_mm_set1_ps(6.9315308e-1f), p, fpart);
+    p = eSimdFma(_mm_set1_ps(9.9999994e-1f), p, fpart);
+
+    return eSimdMul(expipart, p);
+}
+
+// returns the sum of all 4 lanes
+eFORCEINLINE eF32 eSimdHorizontalSum(eF32x4 v)
+{
+    eF32x4 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(sum);
+}
+
 enum eSimdConsts
 {
   eSIMD_MSB1_REST0 = 0x80000000, // 0b10000000 00000000 00000000 00000000
@@ -32,5 +32,6 @@
 #include "simd.hpp"
 #include "random.hpp"
 #include "array.hpp"
+#include "lockfree.hpp"
 
 #endif
@@ -24,20 +24,62 @@
  
  *********************************************************************/
 
+#include <mutex>
+#include <utility>
+
 #include "../runtime/system.hpp"
 #include "tf4.hpp"
 
 // ------------------------------------------------------------------------------------
-// HELPER FUNCTIONS
+// LOOKUP TABLES
 // ------------------------------------------------------------------------------------
 
-eBool eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volume)
+// deterministic tables are generated by the compiler and end up
+// read-only in the binary, shared by all instances and processes.
+// eConstSin() and eConstExp() are series, not the libm functions
+// the tables were filled with at startup before, so some entries
+// differ from those by one ulp (6e-8 at most). sounds don't change
+// audibly, but rendered output is not bit-identical to older builds.
+
+template<eU32 N> struct eTfConstTable
 {
-    eF32 *signal1 = master[0];
-    eF32 *signal2 = master[1];
-    eF32 *mix1 = in[0];
-    eF32 *mix2 = in[1];
+    eF32 values[N];
+};
+
+template<class GEN, std::size_t... I>
+constexpr eTfConstTable<sizeof...(I)> _eTfMakeTable(std::index_sequence<I...>)
+{
+    return {{ GEN::at(I)... }};
+}
+
+struct _eTfSinTableGen
+{
+    static constexpr eF32 at(eU32 i) { return (eF32)eConstSin((eF32)i / TF_MAXFRAMESIZE * 2 * ePI); }
+};
+
+struct _eTfExpTableGen
+{
+    static constexpr eF32 at(eU32 i) { return (eF32)eConstExp(-(5.0f / TF_MAXFRAMESIZE * i)); }
+};
 
+// frequency (Hz) of each midi note. 6.875 Hz is an a, three
+// semitones up gives c, the frequency of midi note 0.
+struct _eTfFreqTableGen
+{
+    static constexpr eF64 freq(eU32 semitones) { return semitones == 0 ? 6.875 : freq(semitones - 1) * TF_12TH_ROOT_OF_2; }
+    static constexpr eF32 at(eU32 i) { return (eF32)freq(i + 3); }
+};
+
+static constexpr eTfConstTable<TF_MAXFRAMESIZE> s_sinTable  = _eTfMakeTable<_eTfSinTableGen>(std::make_index_sequence<TF_MAXFRAMESIZE>());
+static constexpr eTfConstTable<TF_MAXFRAMESIZE> s_expTable  = _eTfMakeTable<_eTfExpTableGen>(std::make_index_sequence<TF_MAXFRAMESIZE>());
+static constexpr eTfConstTable<TF_NUMFREQS>     s_freqTable = _eTfMakeTable<_eTfFreqTableGen>(std::make_index_sequence<TF_NUMFREQS>());
+
+// ------------------------------------------------------------------------------------
+// HELPER FUNCTIONS
+// ------------------------------------------------------------------------------------
+
+static eF32 _eTfSignalGain(eF32 volume)
+{
     if (volume <= 0.5f)
     {
         volume *= 2.0f;
@@ -50,7 +92,22 @@ eBool eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volume)
         volume += 1.0f;
     }
 
-    eF32x2 const_vol = eSimdSetAll(volume);
+    return volume;
+}
+
+// the volume ramps linearly from volumeFrom to volume over the signal
+eBool eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volumeFrom, eF32 volume)
+{
+    eF32 *signal1 = master[0];
+    eF32 *signal2 = master[1];
+    eF32 *mix1 = in[0];
+    eF32 *mix2 = in[1];
+
+    volume = _eTfSignalGain(volume);
+    volumeFrom = _eTfSignalGain(volumeFrom);
+
+    eF32x2 const_vol = eSimdSetAll(volumeFrom);
+    eF32x2 vol_step = eSimdSetAll((volume - volumeFrom) / length);
     eF32 hasSignal = 0.0f;
 
     while(length--)
@@ -70,6 +127,8 @@ eBool eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volume)
 
         signal1++;
         signal2++;
+
+        const_vol = eSimdAdd(const_vol, vol_step);
     }
 
     return hasSignal > 1.0f;
@@ -123,6 +182,30 @@ void eTfSignalToPeak(eF32 **sig, eF32 *peak_left, eF32 *peak_right, eU32 length)
     eSimdStore2(peak, *peak_left, *peak_right);
 }
 
+eF32 eTfSignalMaxAbs(eF32 **sig, eU32 length)
+{
+    eF32 *srcLeft = sig[0];
+    eF32 *srcRight = sig[1];
+
+    eF32x4 peak = eSimdZero();
+    eU32 i = 0;
+
+    for (; i+4<=length; i+=4)
+    {
+        peak = eSimdMax(peak, eSimdAbs(eSimdLoad(&srcLeft[i])));
+        peak = eSimdMax(peak, eSimdAbs(eSimdLoad(&srcRight[i])));
+    }
+
+    eALIGN16 eF32 lanes[4];
+    eSimdStore(peak, lanes);
+    eF32 result = eMax(eMax(lanes[0], lanes[1]), eMax(lanes[2], lanes[3]));
+
+    for (; i<length; i++)
+        result = eMax(result, eMax(eAbs(srcLeft[i]), eAbs(srcRight[i])));
+
+    return result;
+}
+
 // ------------------------------------------------------------------------------------
 // ENVELOPE
 // ------------------------------------------------------------------------------------
@@ -278,7 +361,7 @@ void eTfLfoProcess(eTfSynth &synth, eTfInstrument &instr, eTfLfo &lfoState, eU32
             break;
         case 4:
             // noise
-            result = synth.lfoNoiseTable[eFtoL(lfoState.phase / (ePI*2) * TF_LFONOISETABLESIZE)];
+            result = synth.tables->lfoNoiseTable[eFtoL(lfoState.phase / (ePI*2) * TF_LFONOISETABLESIZE)];
             break;
     }
 
@@ -654,7 +737,7 @@ void eTfGeneratorUpdate(eTfSynth &synth, eTfInstrument &instr, eTfVoice &voice,
                 if (dist < 5.0f)
                 {
                     eU32 expLookup = eFtoL(dist / 5.0f * (TF_MAXFRAMESIZE-1));
-                    eF32 exp = synth.expBuffer[expLookup];
+                    eF32 exp = s_expTable.values[expLookup];
                     exp *= *volumePtr;
                     amp += exp;
                 }
@@ -692,7 +775,7 @@ eBool eTfGeneratorModulate(eTfSynth &synth, eTfInstrument &instr, eTfVoice &voic
 
     eF32 *readPtr = generator.freqTable;
     eF32 *writePtr = generator.freqModTable;
-    eF32 *randPtr = synth.randomBuffer;
+    const eF32 *randPtr = synth.tables->randomBuffer;
 
     for (eU32 i=0; i<frameSizeHalf; i++)
     {
@@ -705,8 +788,8 @@ eBool eTfGeneratorModulate(eTfSynth &synth, eTfInstrument &instr, eTfVoice &voic
         eU32 sinLookup = eFtoL(sineOffset * modulationStrength) % TF_FRAMESIZE;
         eU32 cosLookup = (sinLookup + TF_FRAMESIZE/4) % TF_FRAMESIZE;
 
-        *writePtr++ = *readPtr++ * synth.sinBuffer[sinLookup];
-        *writePtr++ = *readPtr++ * synth.sinBuffer[cosLookup];
+        *writePtr++ = *readPtr++ * s_sinTable.values[sinLookup];
+        *writePtr++ = *readPtr++ * s_sinTable.values[cosLookup];
     }
 
     generator.freqModTable[0] = 1.0f;
@@ -870,13 +953,6 @@ void eTfNoiseUpdate(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eTfM
 
     state.filterOn = bw < 0.99f;
     state.amount = noise * velocity * eTfModMatrixGet(modMatrix, eTfModMatrix::OUTPUT_NOISE_AMOUNT);
-
-    if (state.filterOn && state.amount > 0.0f)
-    {
-        eF32 f = instr.params[TF_NOISE_FREQ];
-        eTfFilterUpdate(synth, *state.filterHP, f - bw, 0.05f, eTfFilter::FILTER_HP);
-        eTfFilterUpdate(synth, *state.filterLP, f + bw, 0.05f, eTfFilter::FILTER_LP);
-    }
 }
 
 eBool eTfNoiseProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eF32 **signal, eU32 frameSize)
@@ -886,20 +962,35 @@ eBool eTfNoiseProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eF
 
     if (state.amount > 0.01f)
     {
-        eU32 len = frameSize;
-        while(len--)
+        if (state.filterOn)
         {
-            *signal1++ = synth.whiteNoiseTable[state.offset1++] * state.amount;
-            *signal2++ = synth.whiteNoiseTable[state.offset2++] * state.amount;
+            eTfNoiseBank &bank = instr.noiseBank;
+            if (!bank.rendered)
+                eTfNoiseBankProcess(synth, instr, bank, frameSize);
 
-            if (state.offset1 >= TF_NOISETABLESIZE) state.offset1 = 0;
-            if (state.offset2 >= TF_NOISETABLESIZE) state.offset2 = 0;
-        }
+            // every voice taps the shared stream at its own delay. delay + frame
+            // never exceeds the ring size, so the tap only covers rendered samples.
+            const eU32 mask = TF_NOISEBANKSIZE - 1;
+            eU32 pos1 = (bank.blockOffset - state.offset1 % (TF_NOISEBANKSIZE - TF_MAXFRAMESIZE)) & mask;
+            eU32 pos2 = (bank.blockOffset - state.offset2 % (TF_NOISEBANKSIZE - TF_MAXFRAMESIZE)) & mask;
 
-        if (state.filterOn)
+            for (eU32 i=0; i<frameSize; i++)
+            {
+                signal1[i] = bank.buffer[0][(pos1 + i) & mask] * state.amount;
+                signal2[i] = bank.buffer[1][(pos2 + i) & mask] * state.amount;
+            }
+        }
+        else
         {
-            eTfFilterProcess(*state.filterLP, eTfFilter::FILTER_LP, signal, frameSize);
-            eTfFilterProcess(*state.filterHP, eTfFilter::FILTER_HP, signal, frameSize);
+            eU32 len = frameSize;
+            while(len--)
+            {
+                *signal1++ = synth.tables->whiteNoiseTable[state.offset1++] * state.amount;
+                *signal2++ = synth.tables->whiteNoiseTable[state.offset2++] * state.amount;
+
+                if (state.offset1 >= TF_NOISETABLESIZE) state.offset1 = 0;
+                if (state.offset2 >= TF_NOISETABLESIZE) state.offset2 = 0;
+            }
         }
 
         return eTRUE;
@@ -913,6 +1004,59 @@ eBool eTfNoiseProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eF
     }
 }
 
+void eTfNoiseBankReset(eTfNoiseBank &bank)
+{
+    bank.offset1 = 0;
+    bank.offset2 = TF_NOISETABLESIZE/2;
+    bank.writeOffset = 0;
+    bank.blockOffset = 0;
+    bank.primed = eFALSE;
+    bank.rendered = eFALSE;
+}
+
+static void _eTfNoiseBankRender(eTfSynth &synth, eTfNoiseBank &bank, eU32 count)
+{
+    while (count)
+    {
+        eU32 run = eMin(count, TF_NOISEBANKSIZE - bank.writeOffset);
+        eF32 *signal[2] = { &bank.buffer[0][bank.writeOffset], &bank.buffer[1][bank.writeOffset] };
+
+        for (eU32 i=0; i<run; i++)
+        {
+            signal[0][i] = synth.tables->whiteNoiseTable[bank.offset1++];
+            signal[1][i] = synth.tables->whiteNoiseTable[bank.offset2++];
+
+            if (bank.offset1 >= TF_NOISETABLESIZE) bank.offset1 = 0;
+            if (bank.offset2 >= TF_NOISETABLESIZE) bank.offset2 = 0;
+        }
+
+        eTfFilterProcess(*bank.filterLP, eTfFilter::FILTER_LP, signal, run);
+        eTfFilterProcess(*bank.filterHP, eTfFilter::FILTER_HP, signal, run);
+
+        bank.writeOffset = (bank.writeOffset + run) & (TF_NOISEBANKSIZE - 1);
+        count -= run;
+    }
+}
+
+void eTfNoiseBankProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoiseBank &bank, eU32 frameSize)
+{
+    eF32 f = instr.params[TF_NOISE_FREQ];
+    eF32 bw = instr.params[TF_NOISE_BW];
+    eTfFilterUpdate(synth, *bank.filterHP, f - bw, 0.05f, eTfFilter::FILTER_HP);
+    eTfFilterUpdate(synth, *bank.filterLP, f + bw, 0.05f, eTfFilter::FILTER_LP);
+
+    // fill the whole history voices may reach back into once
+    if (!bank.primed)
+    {
+        _eTfNoiseBankRender(synth, bank, TF_NOISEBANKSIZE - frameSize);
+        bank.primed = eTRUE;
+    }
+
+    bank.blockOffset = bank.writeOffset;
+    _eTfNoiseBankRender(synth, bank, frameSize);
+    bank.rendered = eTRUE;
+}
+
 // ------------------------------------------------------------------------------------
 // FILTER
 // ------------------------------------------------------------------------------------
@@ -1172,17 +1316,97 @@ void eTfInstrumentInit(eTfSynth &synth, eTfInstrument &instr)
 {
     instr.lfo1Phase = instr.lfo2Phase = 0.0f;
 
+    for(eU32 i=0; i<TF_PARAM_COUNT; i++)
+        instr.paramRamping[i] = eFALSE;
+
+    instr.paramRampCount = 0;
+
     for(eU32 i=0; i<TF_MAXEFFECTS; i++)
     {
         instr.effects[i] = nullptr;
         instr.effectIndex[i] = 0;
+        instr.effectQuietTime[i] = 0.0f;
+        instr.effectSleeping[i] = eFALSE;
     }
 
+    instr.effectSampleRate = synth.sampleRate;
+    instr.effectPool = nullptr;
+    instr.convolutionIr = nullptr;
+
     for(eU32 i=0; i<TF_MAXVOICES; i++)
         eTfVoiceReset(instr.voice[i]);
+
+    eTfNoiseBankReset(instr.noiseBank);
+}
+
+void eTfInstrumentFreeEffects(eTfInstrument &instr)
+{
+    for(eU32 i=0; i<TF_MAXEFFECTS; i++)
+    {
+        if (instr.effects[i])
+            s_effectDelete[instr.effectIndex[i]](instr.effects[i]);
+
+        instr.effects[i] = nullptr;
+        instr.effectIndex[i] = 0;
+    }
+}
+
+static void _eTfInstrumentReleaseEffect(eTfInstrument &instr, eU32 slot)
+{
+    eTfEffect *fx = instr.effects[slot];
+
+    if (fx)
+    {
+        if (instr.effectPool)
+            eTfEffectPoolRelease(*instr.effectPool, instr.effectIndex[slot], fx);
+        else
+            s_effectDelete[instr.effectIndex[slot]](fx);
+    }
+
+    instr.effects[slot] = nullptr;
+    instr.effectIndex[slot] = 0;
+    instr.effectQuietTime[slot] = 0.0f;
+    instr.effectSleeping[slot] = eFALSE;
+}
+
+// runs a voice filter. while its cutoff or resonance ramps, the
+// coefficients are updated every TF_PARAM_RAMPSTEP samples.
+static void _eTfVoiceFilter(eTfSynth &synth, eTfInstrument &instr, eTfFilter &filter, eTfFilter::Type type,
+                            eU32 cutoffParam, eU32 resParam, eF32 cutoffMod, eF32 resMod, eF32 **signal, eU32 frameSize)
+{
+    if (!instr.paramRamping[cutoffParam] && !instr.paramRamping[resParam])
+    {
+        eTfFilterUpdate(synth, filter, instr.params[cutoffParam] * cutoffMod, instr.params[resParam] * resMod, type);
+        eTfFilterProcess(filter, type, signal, frameSize);
+        return;
+    }
+
+    eF32 cutoffFrom = eTfInstrumentGetParamFrom(instr, cutoffParam);
+    eF32 resFrom = eTfInstrumentGetParamFrom(instr, resParam);
+
+    for (eU32 pos=0; pos<frameSize; pos+=TF_PARAM_RAMPSTEP)
+    {
+        eU32 len = eMin(TF_PARAM_RAMPSTEP, frameSize-pos);
+        eF32 t = (eF32)(pos+len) / (eF32)frameSize;
+        eF32 cutoff = eLerp(cutoffFrom, instr.params[cutoffParam], t);
+        eF32 res = eLerp(resFrom, instr.params[resParam], t);
+        eF32 *part[2] = { signal[0]+pos, signal[1]+pos };
+
+        eTfFilterUpdate(synth, filter, cutoff * cutoffMod, res * resMod, type);
+        eTfFilterProcess(filter, type, part, len);
+    }
 }
 
 eF32 eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs, long frameSize)
+{
+    eTfEffectInput input;
+    eTfInstrumentGetEffectInput(synth, instr, input);
+
+    eTfInstrumentProcessVoices(synth, instr, outputs, frameSize);
+    return eTfInstrumentProcessEffects(synth, instr, input, outputs, frameSize);
+}
+
+void eTfInstrumentProcessVoices(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs, long frameSize)
 {
     eSimdSetArithmeticFlags(eSAF_FTZ);
     eASSERT(frameSize <= TF_MAXFRAMESIZE);
@@ -1191,13 +1415,15 @@ eF32 eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs,
     tempBuffers[0] = instr.tempBuffers[0];
     tempBuffers[1] = instr.tempBuffers[1];
 
+    // the shared noise stream is rendered by the first voice needing it
+    instr.noiseBank.rendered = eFALSE;
+
     for(eU32 k=0;k<TF_MAXVOICES;k++)
     {
         eTfVoice &voice = instr.voice[k];
 
         if (voice.noteIsOn || voice.playing)
         {
-            instr.effectsInactiveTime = 0.0f;
             voice.time++;
 
             //  RUN MOD MATRIX
@@ -1221,7 +1447,7 @@ eF32 eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs,
 
             //  CALCULATE FREQUENCY
             // -------------------------------------------------------------------------------
-            eF32 baseFreq = synth.freqTable[voice.currentNote & 0x7f];
+            eF32 baseFreq = s_freqTable.values[voice.currentNote & 0x7f];
             eF32 prevFreq = baseFreq;
             eF32 nextFreq = baseFreq;
 
@@ -1279,94 +1505,135 @@ eF32 eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs,
             // -------------------------------------------------------------------------------
             if (instr.params[TF_LP_FILTER_ON] > 0.5f)
             {
-                eF32 lpCutoff = instr.params[TF_LP_FILTER_CUTOFF];
-                eF32 lpResonance = instr.params[TF_LP_FILTER_RESONANCE];
-
-                lpCutoff *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_LP_FILTER_CUTOFF);
-                lpResonance *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_LP_FILTER_RESONANCE);
+                eF32 lpCutoffMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_LP_FILTER_CUTOFF);
+                eF32 lpResonanceMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_LP_FILTER_RESONANCE);
 
-                eTfFilterUpdate(synth, *voice.filterLP, lpCutoff, lpResonance, eTfFilter::FILTER_LP);
-                eTfFilterProcess(*voice.filterLP, eTfFilter::FILTER_LP, tempBuffers, frameSize);
+                _eTfVoiceFilter(synth, instr, *voice.filterLP, eTfFilter::FILTER_LP,
+                                TF_LP_FILTER_CUTOFF, TF_LP_FILTER_RESONANCE, lpCutoffMod, lpResonanceMod, tempBuffers, frameSize);
             }
 
             //  RUN HIGHPASS FILTER
             // -------------------------------------------------------------------------------
             if (instr.params[TF_HP_FILTER_ON] > 0.5f)
             {
-                eF32 hpCutoff = instr.params[TF_HP_FILTER_CUTOFF];
-                eF32 hpResonance = instr.params[TF_HP_FILTER_RESONANCE];
+                eF32 hpCutoffMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_HP_FILTER_CUTOFF);
+                eF32 hpResonanceMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_HP_FILTER_RESONANCE);
 
-                hpCutoff *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_HP_FILTER_CUTOFF);
-                hpResonance *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_HP_FILTER_RESONANCE);
-
-                eTfFilterUpdate(synth, *voice.filterHP, hpCutoff, hpResonance, eTfFilter::FILTER_HP);
-                eTfFilterProcess(*voice.filterHP, eTfFilter::FILTER_HP, tempBuffers, frameSize);
+                _eTfVoiceFilter(synth, instr, *voice.filterHP, eTfFilter::FILTER_HP,
+                                TF_HP_FILTER_CUTOFF, TF_HP_FILTER_RESONANCE, hpCutoffMod, hpResonanceMod, tempBuffers, frameSize);
             }
 
             //  RUN BANDPASS FILTER
             // -------------------------------------------------------------------------------
             if (instr.params[TF_BP_FILTER_ON] > 0.5f)
             {
-                eF32 bpCutoff = instr.params[TF_BP_FILTER_CUTOFF];
-                eF32 bpQ = instr.params[TF_BP_FILTER_Q];
-
-                bpCutoff *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_BP_FILTER_CUTOFF);
-                bpQ *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_BP_FILTER_Q);
+                eF32 bpCutoffMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_BP_FILTER_CUTOFF);
+                eF32 bpQMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_BP_FILTER_Q);
 
-                eTfFilterUpdate(synth, *voice.filterBP, bpCutoff, bpQ, eTfFilter::FILTER_BP);
-                eTfFilterProcess(*voice.filterBP, eTfFilter::FILTER_BP, tempBuffers, frameSize);
+                _eTfVoiceFilter(synth, instr, *voice.filterBP, eTfFilter::FILTER_BP,
+                                TF_BP_FILTER_CUTOFF, TF_BP_FILTER_Q, bpCutoffMod, bpQMod, tempBuffers, frameSize);
             }
 
             //  RUN NOTCH FILTER
             // -------------------------------------------------------------------------------
             if (instr.params[TF_NT_FILTER_ON] > 0.5f)
             {
-                eF32 ntCutoff = instr.params[TF_NT_FILTER_CUTOFF];
-                eF32 ntQ = instr.params[TF_NT_FILTER_Q];
+                eF32 ntCutoffMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_NT_FILTER_CUTOFF);
+                eF32 ntQMod = eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_NT_FILTER_Q);
 
-                ntCutoff *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_NT_FILTER_CUTOFF);
-                ntQ *= eTfModMatrixGet(voice.modMatrix, eTfModMatrix::OUTPUT_NT_FILTER_Q);
-
-                eTfFilterUpdate(synth, *voice.filterNT, ntCutoff, ntQ, eTfFilter::FILTER_NT);
-                eTfFilterProcess(*voice.filterNT, eTfFilter::FILTER_NT, tempBuffers, frameSize);
+                _eTfVoiceFilter(synth, instr, *voice.filterNT, eTfFilter::FILTER_NT,
+                                TF_NT_FILTER_CUTOFF, TF_NT_FILTER_Q, ntCutoffMod, ntQMod, tempBuffers, frameSize);
             }
 
             // MIX SIGNAL
             // ------------------------------------------------------------------------------
             eF32 gain = instr.params[TF_GLOBAL_GAIN];
-            voice.playing = eTfSignalMix(outputs, tempBuffers, frameSize, gain);
+            eF32 gainFrom = eTfInstrumentGetParamFrom(instr, TF_GLOBAL_GAIN);
+            voice.playing = eTfSignalMix(outputs, tempBuffers, frameSize, gainFrom, gain);
         }
     }
 
+    // all ramps have reached their targets now
+    for (eU32 i=0; i<instr.paramRampCount; i++)
+        instr.paramRamping[instr.paramRamps[i]] = eFALSE;
+
+    instr.paramRampCount = 0;
+}
+
+static eU32 _eTfEffectIndex(eF32 fxVal)
+{
+    return eFtoL(eRoundNearest(fxVal * (FX_COUNT-1)));
+}
+
+// runs the effect chain in place on a block rendered by
+// eTfInstrumentProcessVoices(). it touches no voice state and
+// reads parameters only from input, so it may run on another
+// thread one block behind the voices.
+eF32 eTfInstrumentProcessEffects(eTfSynth &synth, eTfInstrument &instr, const eTfEffectInput &input, eF32 **outputs, long frameSize)
+{
+    eSimdSetArithmeticFlags(eSAF_FTZ);
+    eASSERT(frameSize <= TF_MAXFRAMESIZE);
+
     //    RUN EFFECTS
     // ------------------------------------------------------------------------------
-    if (instr.effectsInactiveTime < TF_EFFECT_SWITCHOFF_TIME)
+    // delay lines are sized for the sample rate the effect was built for
+    if (instr.effectSampleRate != input.sampleRate)
     {
         for(eU32 i=0;i<TF_MAXEFFECTS;i++)
-        {
-            eTfEffect *fx = instr.effects[i];
+            _eTfInstrumentReleaseEffect(instr, i);
 
-            eU32 oldFxIndex = instr.effectIndex[i];
-            eF32 fxVal = instr.params[TF_EFFECT_1 + i];
-            eU32 fxIndex = eFtoL(eRoundNearest(fxVal * (FX_COUNT-1)));
+        instr.effectSampleRate = input.sampleRate;
+    }
 
-            if (fxIndex != oldFxIndex && oldFxIndex != 0)
-            {
-                s_effectDelete[oldFxIndex](fx);
-                instr.effects[i] = fx = nullptr;
-                instr.effectIndex[i] = 0;
-            }
+    const eF32 blockTime = (eF32)frameSize / input.sampleRate;
 
-            if (fxIndex != 0 && fx == nullptr)
-            {
-				if (s_effectCreate[fxIndex]) {
-					instr.effects[i] = fx = s_effectCreate[fxIndex]();
-					instr.effectIndex[i] = fxIndex;
-				}
+    for(eU32 i=0;i<TF_MAXEFFECTS;i++)
+    {
+        eU32 oldFxIndex = instr.effectIndex[i];
+        eU32 fxIndex = _eTfEffectIndex(input.params[TF_EFFECT_1 + i]);
+
+        if (fxIndex != oldFxIndex && oldFxIndex != 0)
+            _eTfInstrumentReleaseEffect(instr, i);
+
+        eTfEffect *fx = instr.effects[i];
+
+        if (fxIndex != 0 && fx == nullptr)
+        {
+            if (s_effectCreate[fxIndex]) {
+                // with a pool the instance may not be ready yet,
+                // the slot then stays bypassed for a few blocks
+                if (instr.effectPool)
+                    fx = eTfEffectPoolAcquire(*instr.effectPool, fxIndex, input.sampleRate);
+                else
+                    fx = s_effectCreate[fxIndex](input.sampleRate);
+
+                if (fx) {
+                    instr.effects[i] = fx;
+                    instr.effectIndex[i] = fxIndex;
+                }
             }
+        }
+
+        if (fx == nullptr)
+            continue;
 
-            if (fx != nullptr)
-                s_effectProcess[fxIndex](fx, synth, instr, outputs, frameSize);
+        // each slot sleeps on its own once input and tail have died away
+        if (eTfSignalMaxAbs(outputs, frameSize) > TF_EFFECT_SILENCE)
+        {
+            instr.effectQuietTime[i] = 0.0f;
+            instr.effectSleeping[i] = eFALSE;
+        }
+        else if (instr.effectSleeping[i])
+            continue;
+        else
+            instr.effectQuietTime[i] += blockTime;
+
+        s_effectProcess[fxIndex](fx, synth, input, outputs, frameSize);
+
+        if (instr.effectQuietTime[i] >= s_effectTail[fxIndex](synth, input) &&
+            eTfSignalMaxAbs(outputs, frameSize) <= TF_EFFECT_SILENCE)
+        {
+            instr.effectSleeping[i] = eTRUE;
         }
     }
 
@@ -1375,12 +1642,34 @@ eF32 eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs,
     eTfSignalToPeak(outputs, &peak_left, &peak_right, frameSize);
     eF32 peak = (peak_left + peak_right) / 2.0f;
 
-    if (eIsFloatZero(peak))
-        instr.effectsInactiveTime += (eF32)frameSize / synth.sampleRate;
-
     return peak;
 }
 
+void eTfInstrumentGetEffectInput(eTfSynth &synth, eTfInstrument &instr, eTfEffectInput &input)
+{
+    eMemCopy(input.params, instr.params, sizeof(input.params));
+    input.sampleRate = synth.sampleRate;
+    input.convolutionIr = instr.convolutionIr;
+}
+
+// the tail of the effects the parameters select, whether their
+// instances exist yet or not. only reads input, so any thread
+// holding its own copy may ask.
+eF32 eTfInstrumentGetTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    eF32 tail = 0.0f;
+
+    for(eU32 i=0;i<TF_MAXEFFECTS;i++)
+    {
+        eU32 fxIndex = _eTfEffectIndex(input.params[TF_EFFECT_1 + i]);
+
+        if (s_effectTail[fxIndex])
+            tail += s_effectTail[fxIndex](synth, input);
+    }
+
+    return eMin(tail, TF_EFFECT_MAXTAIL);
+}
+
 void eTfInstrumentNoteOn(eTfInstrument &instr, eS32 note, eS32 velocity)
 {
     eF32 lfoPhase1 = 0.0f;
@@ -1440,6 +1729,47 @@ void eTfInstrumentPanic(eTfInstrument &instr)
     }
 }
 
+static eBool _eTfIsRampedParam(eU32 index)
+{
+    switch (index)
+    {
+    case TF_GLOBAL_GAIN:
+    case TF_LP_FILTER_CUTOFF:
+    case TF_LP_FILTER_RESONANCE:
+    case TF_HP_FILTER_CUTOFF:
+    case TF_HP_FILTER_RESONANCE:
+    case TF_BP_FILTER_CUTOFF:
+    case TF_BP_FILTER_Q:
+    case TF_NT_FILTER_CUTOFF:
+    case TF_NT_FILTER_Q:
+        return eTRUE;
+    }
+
+    return eFALSE;
+}
+
+// continuous parameters ramp from their current value to the new one
+// over the next frame, all others change at once. generator volume and
+// panning need no ramp, eTfGeneratorProcess already slides between frames.
+void eTfInstrumentSetParam(eTfInstrument &instr, eU32 index, eF32 value)
+{
+    eASSERT(index < TF_PARAM_COUNT);
+
+    if (value != instr.params[index] && !instr.paramRamping[index] && _eTfIsRampedParam(index))
+    {
+        instr.paramFrom[index] = instr.params[index];
+        instr.paramRamping[index] = eTRUE;
+        instr.paramRamps[instr.paramRampCount++] = index;
+    }
+
+    instr.params[index] = value;
+}
+
+eF32 eTfInstrumentGetParamFrom(eTfInstrument &instr, eU32 index)
+{
+    return instr.paramRamping[index] ? instr.paramFrom[index] : instr.params[index];
+}
+
 eU32 eTfInstrumentGetPolyphony(eTfInstrument &instr)
 {
     eU32 count = 0;
@@ -1453,6 +1783,22 @@ eU32 eTfInstrumentGetPolyphony(eTfInstrument &instr)
     return count;
 }
 
+// true once no voice plays and every effect has gone to sleep,
+// so rendering the instrument would only produce silence
+eBool eTfInstrumentIsIdle(eTfInstrument &instr)
+{
+    if (eTfInstrumentGetPolyphony(instr) > 0)
+        return eFALSE;
+
+    for(eU32 i=0;i<TF_MAXEFFECTS;i++)
+    {
+        if (instr.effects[i] && !instr.effectSleeping[i])
+            return eFALSE;
+    }
+
+    return eTRUE;
+}
+
 eU32 eTfInstrumentAllocateVoice(eTfInstrument &instr)
 {
     eU32 poly = eFtoL(instr.params[TF_GEN_POLYPHONY] * (TF_MAXVOICES-1) + 1);
@@ -1478,33 +1824,19 @@ eU32 eTfInstrumentAllocateVoice(eTfInstrument &instr)
 // SYNTH
 // ------------------------------------------------------------------------------------
 
-void eTfSynthInit(eTfSynth &synth)
+static void _eTfSynthTablesBuild(eTfSynthTables &tables)
 {
     eRandom rand;
     rand.seedRandomly();
 
     for (eU32 i=0; i<TF_MAXFRAMESIZE; i++)
     {
-        synth.randomBuffer[i] = eSin(rand.nextFloat(0.0f, eTWOPI));
-        synth.sinBuffer[i] = eSin((eF32)i / TF_MAXFRAMESIZE * 2 * ePI);
-        synth.expBuffer[i] = eExp(-(5.0f / TF_MAXFRAMESIZE * i));
-    }
-
-    // make frequency (Hz) table
-    eF64 a = 6.875;    // a
-    a *= TF_12TH_ROOT_OF_2;    // b
-    a *= TF_12TH_ROOT_OF_2;    // bb
-    a *= TF_12TH_ROOT_OF_2;    // c, frequency of midi note 0
-
-    for (eU32 i = 0; i < TF_NUMFREQS; i++)    // 128 midi notes
-    {
-        synth.freqTable[i] = (eF32)a;
-        a *= TF_12TH_ROOT_OF_2;
+        tables.randomBuffer[i] = eSin(rand.nextFloat(0.0f, eTWOPI));
     }
 
     for (eU32 i=0;i<TF_LFONOISETABLESIZE;i++)
     {
-        synth.lfoNoiseTable[i] = rand.nextFloat(0.0f, 1.0f);
+        tables.lfoNoiseTable[i] = rand.nextFloat(0.0f, 1.0f);
     }
 
     for (eU32 i=0;i<TF_NOISETABLESIZE;i++)
@@ -1515,10 +1847,56 @@ void eTfSynthInit(eTfSynth &synth)
         const static eF32 c3 = 1.f / c1;
 
         eF32 random = rand.nextFloat(0.0f, 1.0f);
-        synth.whiteNoiseTable[i] = (2.f * ((random * c2) + (random * c2) + (random * c2)) - 3.f * (c2 - 1.f)) * c3;
+        tables.whiteNoiseTable[i] = (2.f * ((random * c2) + (random * c2) + (random * c2)) - 3.f * (c2 - 1.f)) * c3;
+    }
+}
+
+static std::mutex       s_synthTablesLock;
+static eTfSynthTables * s_synthTables = nullptr;
+static eU32             s_synthTablesRefs = 0;
+
+const eTfSynthTables * eTfSynthTablesAcquire()
+{
+    std::lock_guard<std::mutex> lock(s_synthTablesLock);
+
+    if (s_synthTablesRefs++ == 0)
+    {
+        s_synthTables = (eTfSynthTables *)eAllocAligned(sizeof(eTfSynthTables), 16);
+        _eTfSynthTablesBuild(*s_synthTables);
     }
 
+    return s_synthTables;
+}
+
+void eTfSynthTablesRelease(const eTfSynthTables *tables)
+{
+    std::lock_guard<std::mutex> lock(s_synthTablesLock);
+    eASSERT(tables == s_synthTables && s_synthTablesRefs > 0);
+
+    // eASSERT is compiled out in release builds, a stray
+    // release must not free the tables others still use
+    if (tables != s_synthTables || s_synthTablesRefs == 0)
+        return;
+
+    if (--s_synthTablesRefs == 0)
+    {
+        eFreeAligned(s_synthTables);
+        s_synthTables = nullptr;
+    }
+}
+
+void eTfSynthInit(eTfSynth &synth)
+{
+    synth.tables = eTfSynthTablesAcquire();
+
     for(eU32 j=0; j<TF_MAX_INSTR; j++)
         synth.instr[j] = nullptr;
+}
+
+void eTfSynthFree(eTfSynth &synth)
+{
+    if (synth.tables)
+        eTfSynthTablesRelease(synth.tables);
 
+    synth.tables = nullptr;
 }
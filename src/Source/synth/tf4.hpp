@@ -32,6 +32,7 @@ const eU32 TF_FRAMESIZE             = 512;
 const eU32 TF_MAXFRAMESIZE          = 4096;
 const eU32 TF_IFFT_FRAMESIZE        = 512;
 const eU32 TF_NOISETABLESIZE        = 65536;
+const eU32 TF_NOISEBANKSIZE         = TF_MAXFRAMESIZE*2; // must be a power of 2
 const eU32 TF_NUMFREQS              = 128;
 const eU32 TF_LFONOISETABLESIZE     = 256;
 const eU32 TF_MODMATRIXENTRIES      = 8;
@@ -48,12 +49,12 @@ const eU32 TF_NUMGENPROFILES        = 4;
 const eU32 TF_LFOSHAPECOUNT         = 5;
 const eU32 TF_MAXMODULATIONTYPES    = 4;
 const eU32 TF_FORMANTCOUNT          = 5;
-const eF32 TF_EFFECT_SWITCHOFF_TIME = 2.0f;
-const eF32 TF_12TH_ROOT_OF_2        = 1.059463094359f;
+constexpr eF32 TF_12TH_ROOT_OF_2    = 1.059463094359f;
+const eU32 TF_PARAM_RAMPSTEP        = 32; // sub-block size of ramped filter parameters
 
 #include "tf4fx.hpp"
 
-static const eF32 TF_OCTAVES[] =
+static constexpr eF32 TF_OCTAVES[] =
 {
     1.0f*16.0f,
     1.0f*8.0f,
@@ -66,6 +67,8 @@ static const eF32 TF_OCTAVES[] =
     1.0f/16.0f,
 };
 
+static_assert(eELEMENT_COUNT(TF_OCTAVES) == TF_MAXOCTAVES, "one multiplier per octave");
+
 enum eTfFftType
 {
     IFFT = 1,
@@ -212,6 +215,8 @@ enum eTfParam
     TF_DELAY_LEFT_GRID,
     TF_DELAY_RIGHT_GRID,
 
+    TF_CONV_WET,
+
     TF_PARAM_COUNT
 };
 
@@ -376,6 +381,9 @@ static const eF32 TF_DEFAULTPROG[] =
     //delay grid (optional - appended here to make it backwards compatible)
     0,
     0,
+
+    //convolution
+    0.3f,
 };
 
 static const eChar * TF_NAMES[] =
@@ -516,6 +524,8 @@ static const eChar * TF_NAMES[] =
     
     "DelayLGrid",
     "DelayRGrid",
+
+    "ConvWet",
 };
 
 #endif
@@ -687,13 +697,25 @@ struct eTfFilter
 
 struct eTfNoise
 {
-    eTfNoise()
+    eU32            offset1;
+    eU32            offset2;
+    eBool           filterOn;
+    eF32            amount;
+};
+
+// band-limited noise shared by all voices of an instrument. the filter
+// coefficients only depend on instrument parameters, so the white noise
+// is filtered once per block into a ring buffer and every voice reads
+// from it at its own, decorrelating delay.
+struct eTfNoiseBank
+{
+    eTfNoiseBank()
     {
         filterLP = (eTfFilter*)eAllocAlignedAndZero(sizeof(eTfFilter), 16);
         filterHP = (eTfFilter*)eAllocAlignedAndZero(sizeof(eTfFilter), 16);
     }
 
-    ~eTfNoise()
+    ~eTfNoiseBank()
     {
         eFreeAligned(filterLP);
         eFreeAligned(filterHP);
@@ -701,10 +723,13 @@ struct eTfNoise
 
     eU32            offset1;
     eU32            offset2;
-    eBool           filterOn;
+    eU32            writeOffset;
+    eU32            blockOffset;
+    eBool           primed;
+    eBool           rendered;
     eTfFilter *     filterHP;
     eTfFilter *     filterLP;
-    eF32            amount;
+    eF32            buffer[2][TF_NOISEBANKSIZE];
 };
 
 struct eTfVoice
@@ -767,21 +792,48 @@ struct eTfInstrument
     eF32            lfo2Phase;
     eTfVoice        voice[TF_MAXVOICES];
     eTfVoice *      latestTriggeredVoice;
+    eTfNoiseBank    noiseBank;
     eF32            tempBuffers[2][TF_MAXFRAMESIZE];
     eTfEffect *     effects[TF_MAXEFFECTS];
     eU32            effectIndex[TF_MAXEFFECTS];
-    eF32            effectsInactiveTime;
+    eF32            effectQuietTime[TF_MAXEFFECTS];
+    eBool           effectSleeping[TF_MAXEFFECTS];
+    eU32            effectSampleRate;
+    eTfEffectPool * effectPool; // optional, effects are created in place without it
+    eTfConvolutionIrExchange * convolutionIr; // optional, convolution passes through without it
+
+    // continuous parameters changed since the last frame ramp
+    // linearly from paramFrom to params over the next frame
+    eF32            paramFrom[TF_PARAM_COUNT];
+    eBool           paramRamping[TF_PARAM_COUNT];
+    eU32            paramRamps[TF_PARAM_COUNT];
+    eU32            paramRampCount;
 };
 
-struct eTfSynth
+// everything the effect chain reads besides its own instances.
+// the pipelined chain gets a copy taken when its block was
+// submitted, so the instrument may move on in the meantime.
+struct eTfEffectInput
 {
+    eF32            params[TF_PARAM_COUNT];
     eU32            sampleRate;
+    eTfConvolutionIrExchange * convolutionIr;
+};
+
+// random lookup tables, built once and then shared read-only
+// by all synths in the process. the deterministic ones are
+// generated at compile time.
+struct eTfSynthTables
+{
     eF32            randomBuffer[TF_MAXFRAMESIZE];
-    eF32            sinBuffer[TF_MAXFRAMESIZE];
-    eF32            expBuffer[TF_MAXFRAMESIZE];
-    eF32            freqTable[TF_NUMFREQS];
     eF32            lfoNoiseTable[TF_LFONOISETABLESIZE];
     eF32            whiteNoiseTable[TF_NOISETABLESIZE];
+};
+
+struct eTfSynth
+{
+    eU32            sampleRate;
+    const eTfSynthTables * tables;
     eTfInstrument * instr[TF_MAX_INSTR];
 };
 
@@ -824,9 +876,10 @@ struct eTfPlayer
     eS16                outputFinal[sizeof(eF32)*TF_FRAMESIZE];
 };
 
-eBool   eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volume);
+eBool   eTfSignalMix(eF32 **master, eF32 **in, eU32 length, eF32 volumeFrom, eF32 volume);
 void    eTfSignalToS16(eF32 **sig, eS16 *out, const eF32 gain, eU32 length);
 void    eTfSignalToPeak(eF32 **sig, eF32 *peak_left, eF32 *peak_right, eU32 length);
+eF32    eTfSignalMaxAbs(eF32 **sig, eU32 length);
 
 void    eTfEnvelopeReset(eTfEnvelope &state);
 eBool   eTfEnvelopeIsEnd(eTfEnvelope &state);
@@ -856,6 +909,9 @@ void    eTfNoiseReset(eTfNoise &state);
 void    eTfNoiseUpdate(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eTfModMatrix &modMatrix, eF32 velocity);
 eBool   eTfNoiseProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoise &state, eF32 **signal, eU32 frameSize);
 
+void    eTfNoiseBankReset(eTfNoiseBank &bank);
+void    eTfNoiseBankProcess(eTfSynth &synth, eTfInstrument &instr, eTfNoiseBank &bank, eU32 frameSize);
+
 void    eTfFilterUpdate(eTfSynth &synth, eTfFilter &state, eF32 f, eF32 q, eTfFilter::Type type);
 void    eTfFilterProcess(eTfFilter &state, eTfFilter::Type type, eF32 **signal, eU32 frameSize);
 
@@ -866,15 +922,27 @@ void    eTfVoicePitchBend(eTfVoice &state, eF32 semitones, eF32 cents);
 void    eTfVoicePanic(eTfVoice &state);
 
 void    eTfInstrumentInit(eTfSynth &synth, eTfInstrument &instr);
+void    eTfInstrumentFreeEffects(eTfInstrument &instr);
+eF32    eTfInstrumentGetTail(eTfSynth &synth, const eTfEffectInput &input);
 eF32    eTfInstrumentProcess(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs, long sampleFrames);
+void    eTfInstrumentProcessVoices(eTfSynth &synth, eTfInstrument &instr, eF32 **outputs, long sampleFrames);
+eF32    eTfInstrumentProcessEffects(eTfSynth &synth, eTfInstrument &instr, const eTfEffectInput &input, eF32 **outputs, long sampleFrames);
+void    eTfInstrumentGetEffectInput(eTfSynth &synth, eTfInstrument &instr, eTfEffectInput &input);
 void    eTfInstrumentNoteOn(eTfInstrument &instr, eS32 note, eS32 velocity);
 eBool   eTfInstrumentNoteOff(eTfInstrument &instr, eS32 note);
 void    eTfInstrumentAllNotesOff(eTfInstrument &instr);
 void    eTfInstrumentPitchBend(eTfInstrument &instr, eF32 semitones, eF32 cents);
 void    eTfInstrumentPanic(eTfInstrument &instr);
+void    eTfInstrumentSetParam(eTfInstrument &instr, eU32 index, eF32 value);
+eF32    eTfInstrumentGetParamFrom(eTfInstrument &instr, eU32 index);
 eU32    eTfInstrumentGetPolyphony(eTfInstrument &instr);
+eBool   eTfInstrumentIsIdle(eTfInstrument &instr);
 eU32    eTfInstrumentAllocateVoice(eTfInstrument &instr);
 
 void    eTfSynthInit(eTfSynth &synth);
+void    eTfSynthFree(eTfSynth &synth);
+
+const eTfSynthTables *  eTfSynthTablesAcquire();
+void                    eTfSynthTablesRelease(const eTfSynthTables *tables);
 
 #endif
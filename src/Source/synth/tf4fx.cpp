@@ -30,211 +30,201 @@
 #define LEFT 0
 #define RIGHT 1
 
+// time until a loop of the given length and gain rings down to TF_EFFECT_SILENCE
+static eF32 _eTfFeedbackTail(eF32 loopSeconds, eF32 feedback)
+{
+    if (feedback <= 0.0f)
+        return loopSeconds;
+    if (feedback >= 1.0f)
+        return TF_EFFECT_MAXTAIL;
+
+    eF32 trips = eLogE(TF_EFFECT_SILENCE) / eLogE(feedback);
+    return eMin(TF_EFFECT_MAXTAIL, loopSeconds * (trips + 1.0f));
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 //  DELAY
 // ---------------------------------------------------------------------------------------------------------------------------
 
-void eTfDelayInit(eTfDelay &delay, eBool singleDelay)
+void eTfDelayInit(eTfDelay &delay, eBool singleDelay, eU32 maxLen)
 {
+    eU32 size = eNextPowerOf2(eMax<eU32>(maxLen, 2));
+
     eMemZero(delay);
     delay.singleDelay = singleDelay;
+    delay.delayBuffer = (eF32 *)eAllocAlignedAndZero(size * sizeof(eF32), 16);
+    delay.delayMask = size - 1;
+    delay.delayLen = 1;
+}
+
+void eTfDelayFree(eTfDelay &delay)
+{
+    eFreeAligned(delay.delayBuffer);
+    delay.delayBuffer = nullptr;
 }
 
 void eTfDelayUpdate(eTfDelay &delay, eU32 sampleRate, eF32 ms)
 {
     delay.delayLen = eFtoL((eF32)sampleRate * ms / 1000.0f);
-    delay.delayLen = eClamp<eU32>(1, delay.delayLen, TF_DELAY_MAXLEN);
-    if (delay.singleDelay) {
-        eS32 readOffset = delay.writeOffset - delay.delayLen;
-        if (readOffset < 0) readOffset += TF_DELAY_MAXLEN;
-        delay.readOffset = (eU32)readOffset;
-    } else {
-        delay.writeOffset = eClamp<eU32>(0, delay.writeOffset, delay.delayLen-1);
-        delay.readOffset = eClamp<eU32>(0, delay.readOffset, delay.delayLen-1);
-    }
+    delay.delayLen = eClamp<eU32>(1, delay.delayLen, delay.delayMask + 1);
 }
 
 void eTfDelayProcess(eTfDelay &delay, eF32 *signal, eU32 len, eF32 decay)
 {
-    eU32 *read_pos      = &delay.readOffset;
-    eU32 *write_pos     = &delay.writeOffset;
-    eF32 *buffer_src    = &delay.delayBuffer[*read_pos];
-    eF32 *buffer_dest   = &delay.delayBuffer[*write_pos];
-    eU32 wrapPosition   = delay.singleDelay ? TF_DELAY_MAXLEN : delay.delayLen;
-    eF32 mulDest        = delay.singleDelay ? 0.0f : 1.0f;
-
-    while (len--) {
-        // fetch one sample
-        eF32 sample = *signal;
-
-        // write it to buffer
-        *buffer_dest = (sample + (*buffer_dest * mulDest)) * decay;
-        eUndenormalise((*buffer_dest));
-        buffer_dest++;
-
-        // read from buffer and add to sample
-        sample += *buffer_src++;
-
-        // increase write position and verify
-        (*write_pos)++;
-        if ((*write_pos) >= wrapPosition) {
-            (*write_pos) = 0;
-            buffer_dest = delay.delayBuffer;
-        }
+    const eU32 size = delay.delayMask + 1;
+    eF32 *buffer = delay.delayBuffer;
 
-        // increase read position and verify
-        (*read_pos)++;
-        if ((*read_pos) >= wrapPosition) {
-            (*read_pos) = 0;
-            buffer_src = delay.delayBuffer;
-        }
+    while (len)
+    {
+        // split into runs where neither position wraps
+        eU32 writePos = delay.writeOffset;
+        eU32 readPos = (writePos - delay.delayLen) & delay.delayMask;
+        eU32 run = eMin(len, eMin(size - writePos, size - readPos));
 
-        // write to output
-        *signal++ = sample;
-    }
-}
+        eF32 *src = &buffer[readPos];
+        eF32 *dest = &buffer[writePos];
 
-// ---------------------------------------------------------------------------------------------------------------------------
-//  COMB
-// ---------------------------------------------------------------------------------------------------------------------------
+        if (delay.singleDelay)
+        {
+            for (eU32 i=0; i<run; i++)
+            {
+                eF32 delayed = src[i];
+                dest[i] = signal[i] * decay;
+                signal[i] += delayed;
+            }
+        }
+        else
+        {
+            for (eU32 i=0; i<run; i++)
+            {
+                eF32 fed = (signal[i] + src[i]) * decay;
+                eUndenormalise(fed);
+                dest[i] = fed;
+                signal[i] += fed;
+            }
+        }
 
-void eTfCombInit(eTfComb &comb, eU32 size)
-{
-    eASSERT(size+3 < TF_COMB_MAXLEN);
-    eMemZero(comb);
-    comb.bufsize = size;
+        delay.writeOffset = (writePos + run) & delay.delayMask;
+        signal += run;
+        len -= run;
+    }
 }
 
-void eTfCombProcess(eTfComb &comb1, eTfComb &comb2, eF32 damp1, eF32 damp2, eF32 feedback, eF32 gain, eF32 **signals_in, eF32 **signals_out, eU32 len)
+// mixes up to 4 taps of the line into the signal. tap delays are given in
+// samples and move linearly from tapsFrom to tapsTo over the block, taps
+// are read with linear interpolation and summed in SIMD lanes.
+void eTfDelayProcessTaps(eTfDelay &delay, eF32 *signal, eU32 len, const eF32 *tapsFrom, const eF32 *tapsTo, eU32 tapCount, eF32 gain)
 {
-    eF32 *inputL = signals_in[LEFT];
-    eF32 *inputR = signals_in[RIGHT];
-    eF32 *outputL = signals_out[LEFT];
-    eF32 *outputR = signals_out[RIGHT];
+    eASSERT(tapCount > 0 && tapCount <= 4);
 
-    eF32x2 damp2x2 = eSimdSetAll(damp2);
-    eF32x2 damp1x2 = eSimdSetAll(damp1);
-    eF32x2 feedbackx2 = eSimdSetAll(feedback);
+    eALIGN16 eF32 from[4];
+    eALIGN16 eF32 step[4];
+    eALIGN16 eF32 weight[4];
+    eALIGN16 eS32 pos[4];
+    const eF32 maxDelay = (eF32)delay.delayMask - 1.0f;
 
-    while(len--)
+    for (eU32 i=0; i<4; i++)
     {
-        eF32 input = (*inputL++ + *inputR++) * gain;
-        eF32x2 minput = eSimdSetAll(input);
-
-        eF32x2 output = eSimdSet2(comb1.buffer[comb1.bufidx], comb2.buffer[comb2.bufidx]);
-        eF32x2 filterstore = eSimdSet2(comb1.filterstore, comb2.filterstore);
-        filterstore = eSimdAdd(eSimdMul(output, damp2x2), eSimdMul(filterstore, damp1x2));
-
-        eF32x2 buffer = eSimdAdd(minput, eSimdMul(filterstore, feedbackx2));
-
-        eSimdStore2(buffer, comb1.buffer[comb1.bufidx], comb2.buffer[comb2.bufidx]);
-        eSimdStore2(filterstore, comb1.filterstore, comb2.filterstore);
-        eSimdStore2(output, *outputL++, *outputR++);
-
-        if (++comb1.bufidx >= comb1.bufsize) comb1.bufidx = 0;
-        if (++comb2.bufidx >= comb2.bufsize) comb2.bufidx = 0;
+        eU32 tap = (i < tapCount ? i : 0);
+        from[i] = eClamp(1.0f, tapsFrom[tap], maxDelay);
+        step[i] = (eClamp(1.0f, tapsTo[tap], maxDelay) - from[i]) / (eF32)len;
+        weight[i] = (i < tapCount ? gain : 0.0f);
     }
-}
-
-// ---------------------------------------------------------------------------------------------------------------------------
-//  ALLPASS
-// ---------------------------------------------------------------------------------------------------------------------------
 
-void eTfAllpassInit(eTfAllpass &allpass, eU32 size)
-{
-    eASSERT(size+3 < TF_ALLPASS_MAXLEN);
-    eMemZero(allpass);
-    allpass.bufsize = size;
-}
+    eF32x4 delays = eSimdLoadAligned(from);
+    const eF32x4 steps = eSimdLoadAligned(step);
+    const eF32x4 weights = eSimdLoadAligned(weight);
+    const eU32 mask = delay.delayMask;
+    eF32 *buffer = delay.delayBuffer;
+    eU32 w = delay.writeOffset;
 
-void eTfAllpassProcess(eTfAllpass &allpass1, eTfAllpass &allpass2, eF32 feedback, eF32 **signals_in, eF32 **signals_out, eU32 len)
-{
-    eF32 *inputL = signals_in[0];
-    eF32 *inputR = signals_in[1];
-    eF32 *outputL = signals_out[0];
-    eF32 *outputR = signals_out[1];
+    for (eU32 i=0; i<len; i++, w++)
+    {
+        buffer[w & mask] = signal[i];
+        delays = eSimdAdd(delays, steps);
 
-    eF32x2 feedbackx2 = eSimdSetAll(feedback);
+        // tap delays stay clamped above zero, so truncation is the floor
+        __m128i delayInt = _mm_cvttps_epi32(delays);
+        eF32x4 frac = eSimdSub(delays, _mm_cvtepi32_ps(delayInt));
+        _mm_store_si128((__m128i *)pos, _mm_sub_epi32(_mm_set1_epi32(w), delayInt));
 
-    while(len--)
-    {
-        eF32x2 output = eSimdSet2(*inputL++, *inputR++);
-        eF32x2 bufout = eSimdSet2(allpass1.buffer[allpass1.bufidx], allpass2.buffer[allpass2.bufidx]);
-        eF32x2 buffer = eSimdAdd(output, eSimdMul(bufout, feedbackx2));
-        output = eSimdSub(bufout, output);
-        eSimdStore2(buffer, allpass1.buffer[allpass1.bufidx], allpass2.buffer[allpass2.bufidx]);
-        eSimdStore2(output, *outputL++, *outputR++);
+        eF32x4 near = eSimdSet(buffer[pos[3] & mask], buffer[pos[2] & mask], buffer[pos[1] & mask], buffer[pos[0] & mask]);
+        eF32x4 far = eSimdSet(buffer[(pos[3]-1) & mask], buffer[(pos[2]-1) & mask], buffer[(pos[1]-1) & mask], buffer[(pos[0]-1) & mask]);
+        eF32x4 taps = eSimdMul(eSimdFma(near, frac, eSimdSub(far, near)), weights);
 
-        if (++allpass1.bufidx >= allpass1.bufsize) allpass1.bufidx = 0;
-        if (++allpass2.bufidx >= allpass2.bufsize) allpass2.bufidx = 0;
+        signal[i] += eSimdHorizontalSum(taps);
     }
+
+    delay.writeOffset = w & mask;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT DELAY
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectDelayCreate()
+eTfEffect * eTfEffectDelayCreate(eU32 sampleRate)
 {
     eTfEffectDelay *delay = (eTfEffectDelay *)eAllocAlignedAndZero(sizeof(eTfEffectDelay), 16);
-    eTfDelayInit(delay->delay[LEFT], eFALSE);
-    eTfDelayInit(delay->delay[RIGHT], eFALSE);
+    eU32 maxLen = sampleRate * TF_FX_DELAY_MAX_MILLISECONDS / 1000;
+    eTfDelayInit(delay->delay[LEFT], eFALSE, maxLen);
+    eTfDelayInit(delay->delay[RIGHT], eFALSE, maxLen);
     return delay;
 }
 
 void eTfEffectDelayDelete(eTfEffect *fx)
 {
+    eTfEffectDelay *delay = (eTfEffectDelay *)fx;
+    eTfDelayFree(delay->delay[LEFT]);
+    eTfDelayFree(delay->delay[RIGHT]);
     eFreeAligned(fx);
 }
 
-void eTfEffectDelayProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+void eTfEffectDelayProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eASSERT_ALIGNED16(fx);
     eTfEffectDelay *delay = (eTfEffectDelay *)fx;
 
-    eU32 delayLeft = eFtoL(instr.params[TF_DELAY_LEFT] * TF_FX_DELAY_MAX_MILLISECONDS);
-    eU32 delayRight = eFtoL(instr.params[TF_DELAY_RIGHT] * TF_FX_DELAY_MAX_MILLISECONDS);
-    eF32 decay = instr.params[TF_DELAY_DECAY];
+    eU32 delayLeft = eFtoL(input.params[TF_DELAY_LEFT] * TF_FX_DELAY_MAX_MILLISECONDS);
+    eU32 delayRight = eFtoL(input.params[TF_DELAY_RIGHT] * TF_FX_DELAY_MAX_MILLISECONDS);
+    eF32 decay = input.params[TF_DELAY_DECAY];
 
-    eTfDelayUpdate(delay->delay[LEFT], synth.sampleRate, (eF32)delayLeft);
-    eTfDelayUpdate(delay->delay[RIGHT], synth.sampleRate, (eF32)delayRight);
+    eTfDelayUpdate(delay->delay[LEFT], input.sampleRate, (eF32)delayLeft);
+    eTfDelayUpdate(delay->delay[RIGHT], input.sampleRate, (eF32)delayRight);
 
     eTfDelayProcess(delay->delay[LEFT], signal[LEFT], len, decay);
     eTfDelayProcess(delay->delay[RIGHT], signal[RIGHT], len, decay);
 }
 
+eF32 eTfEffectDelayTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    eF32 delay = eMax(input.params[TF_DELAY_LEFT], input.params[TF_DELAY_RIGHT]) * TF_FX_DELAY_MAX_MILLISECONDS / 1000.0f;
+    return _eTfFeedbackTail(delay, input.params[TF_DELAY_DECAY]);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT REVERB
 // ---------------------------------------------------------------------------------------------------------------------------
 
-const eF32 FIXEDGAIN    = 0.015f;
-const eF32 SCALEWET     = 3.0f;
-const eF32 SCALEDRY     = 2.0f;
-const eF32 SCALEDAMP    = 0.4f;
-const eF32 SCALEROOM    = 0.28f;
-const eF32 OFFSETROOM   = 0.7f;
-const eInt STEREOSPREAD = 23;
+constexpr eF32 FIXEDGAIN    = 0.015f;
+constexpr eF32 SCALEWET     = 3.0f;
+constexpr eF32 SCALEDRY     = 2.0f;
+constexpr eF32 SCALEDAMP    = 0.4f;
+constexpr eF32 SCALEROOM    = 0.28f;
+constexpr eF32 OFFSETROOM   = 0.7f;
+constexpr eU32 STEREOSPREAD = 23;
 
-const eInt COMBTUNINGS[]    = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
-const eInt ALLPASSTUNINGS[] = { 556, 441, 341, 225 };
+// delays in samples, combs ascending and allpasses descending
+constexpr eU32 COMBTUNINGS[]    = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+constexpr eU32 ALLPASSTUNINGS[] = { 556, 441, 341, 225 };
 
-eTfEffect * eTfEffectReverbCreate()
-{
-    eTfEffectReverb *reverb = (eTfEffectReverb *)eAllocAlignedAndZero(sizeof(eTfEffectReverb), 16);
+static_assert(eELEMENT_COUNT(COMBTUNINGS) == TF_FX_REVERB_NUMCOMBS, "one tuning per comb");
+static_assert(eELEMENT_COUNT(ALLPASSTUNINGS) == TF_FX_REVERB_NUMALLPASSES, "one tuning per allpass");
+static_assert(COMBTUNINGS[TF_FX_REVERB_NUMCOMBS-1] < TF_FX_REVERB_COMBSIZE, "comb buffers too short");
+static_assert(ALLPASSTUNINGS[0] + STEREOSPREAD < TF_FX_REVERB_ALLPASSSIZE, "allpass buffers too short");
 
-    for (int i=0; i<TF_FX_REVERB_NUMCOMBS; i++)
-    {
-        eTfCombInit(reverb->comb[LEFT][i], COMBTUNINGS[i]);
-        eTfCombInit(reverb->comb[RIGHT][i], COMBTUNINGS[i]);
-    }
-
-    for (int i=0; i<TF_FX_REVERB_NUMALLPASSES; i++)
-    {
-        eTfAllpassInit(reverb->allpass[LEFT][i], ALLPASSTUNINGS[i]);
-        eTfAllpassInit(reverb->allpass[RIGHT][i], ALLPASSTUNINGS[i] + STEREOSPREAD);
-    }
-
-    return reverb;
+eTfEffect * eTfEffectReverbCreate(eU32 sampleRate)
+{
+    return eAllocAlignedAndZero(sizeof(eTfEffectReverb), 16);
 }
 
 void eTfEffectReverbDelete(eTfEffect *fx)
@@ -242,90 +232,97 @@ void eTfEffectReverbDelete(eTfEffect *fx)
     eFreeAligned(fx);
 }
 
-void eTfEffectReverbProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+void eTfEffectReverbProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eASSERT_ALIGNED16(fx);
     eTfEffectReverb *reverb = (eTfEffectReverb *)fx;
 
-    eF32 roomsize          = instr.params[TF_REVERB_ROOMSIZE] * SCALEROOM + OFFSETROOM;
-    eF32 damp              = instr.params[TF_REVERB_DAMP] * SCALEDAMP;
-    eF32 wet               = instr.params[TF_REVERB_WET] * SCALEWET;
-    eF32 dry               = (1.0f - instr.params[TF_REVERB_WET]) * SCALEDRY;
-    eF32 width             = instr.params[TF_REVERB_WIDTH];
+    eF32 roomsize          = input.params[TF_REVERB_ROOMSIZE] * SCALEROOM + OFFSETROOM;
+    eF32 damp              = input.params[TF_REVERB_DAMP] * SCALEDAMP;
+    eF32 wet               = input.params[TF_REVERB_WET] * SCALEWET;
+    eF32 dry               = (1.0f - input.params[TF_REVERB_WET]) * SCALEDRY;
+    eF32 width             = input.params[TF_REVERB_WIDTH];
     eF32 wet1              = wet * (width / 2.0f + 0.5f);
     eF32 wet2              = wet * ((1.0f - width) / 2.0f);
     eF32 dry0              = dry;
-    eF32 cmbFeedback       = roomsize;
     eF32 apsFeedback	   = 0.5f;
-    eF32 damp1             = damp;
     eF32 gain              = FIXEDGAIN;
-    eF32 damp2             = 1.0f - damp;
-
-	//eSwap<eF32*>(signal[LEFT], signal[RIGHT]);
 
-	if (len > TF_MAXFRAMESIZE)
-		return;
+    const eU32 combMask = TF_FX_REVERB_COMBSIZE - 1;
+    const eU32 allpassMask = TF_FX_REVERB_ALLPASSSIZE - 1;
 
-    // erase mixbuffer
-    eF32 *signals_mix[2];
-    signals_mix[LEFT] = &reverb->mixBuffers[0];
-    signals_mix[RIGHT] = &reverb->mixBuffers[TF_MAXFRAMESIZE];
-    eMemSet(signals_mix[LEFT], 0, sizeof(eF32)*len);
-    eMemSet(signals_mix[RIGHT], 0, sizeof(eF32)*len);
-
-    // run comb filters in parallel
-    for (eU32 i=0;i<TF_FX_REVERB_NUMCOMBS; i++)
-    {
-        eF32 *signals_out[2];
-        signals_out[LEFT] = &reverb->combBuffers[TF_MAXFRAMESIZE * 2 * i];
-        signals_out[RIGHT] = &reverb->combBuffers[TF_MAXFRAMESIZE * 2 * i + 1];
-        eTfCombProcess(reverb->comb[LEFT][i], reverb->comb[RIGHT][i], damp1, damp2, cmbFeedback, gain, signal, signals_out, len);
-        eTfSignalMix(signals_mix, signals_out, len, 0.5f);
-    }
-
-    // run allpass filters in serial
-    for (eU32 i=0;i<TF_FX_REVERB_NUMALLPASSES; i++)
-    {
-        eTfAllpassProcess(reverb->allpass[LEFT][i], reverb->allpass[RIGHT][i], apsFeedback, signals_mix, signals_mix, len);
-    }
-
-    // create final signal
-    eF32x2 wet1x2 = eSimdSetAll(wet1);
-    eF32x2 wet2x2 = eSimdSetAll(wet2);
-    eF32x2 dry0x2 = eSimdSetAll(dry0);
-
-	//eSwap<eF32*>(signal[LEFT], signal[RIGHT]);
+    eF32x4 cmbFeedback = eSimdSetAll(roomsize);
+    eF32x4 damp1 = eSimdSetAll(damp);
+    eF32x4 damp2 = eSimdSetAll(1.0f - damp);
+    eF32x4 filterstore0 = eSimdLoad(&reverb->filterstore[0]);
+    eF32x4 filterstore1 = eSimdLoad(&reverb->filterstore[4]);
 
+    eF32 (*comb0)[4] = reverb->combBuffer[0];
+    eF32 (*comb1)[4] = reverb->combBuffer[1];
     eF32 *dryL = signal[LEFT];
     eF32 *dryR = signal[RIGHT];
-    eF32 *wetL = signals_mix[LEFT];
-    eF32 *wetR = signals_mix[RIGHT];
+    eU32 w = reverb->writeOffset;
 
-    while(len--)
+    for (eU32 i=0; i<len; i++, w++)
     {
-        eF32x2 in = eSimdSet2(*dryL, *dryR);
-        eF32x2 wet1 = eSimdSet2(*wetL, *wetR);
-		eF32x2 wet2 = eSimdSet2(*wetR++, *wetL++);
-        eF32x2 out = eSimdSetAll(0.0f);
-
-        out = eSimdAdd(
-                eSimdAdd(
-                    eSimdMul(wet1, wet1x2),
-                    eSimdMul(wet2, wet2x2)),
-                eSimdMul(in, dry0x2));
+        // 8 parallel combs, 4 per vector
+        eF32x4 input = eSimdSetAll((dryL[i] + dryR[i]) * gain);
+        eF32x4 out0 = eSimdSet(comb0[(w - COMBTUNINGS[3]) & combMask][3],
+                               comb0[(w - COMBTUNINGS[2]) & combMask][2],
+                               comb0[(w - COMBTUNINGS[1]) & combMask][1],
+                               comb0[(w - COMBTUNINGS[0]) & combMask][0]);
+        eF32x4 out1 = eSimdSet(comb1[(w - COMBTUNINGS[7]) & combMask][3],
+                               comb1[(w - COMBTUNINGS[6]) & combMask][2],
+                               comb1[(w - COMBTUNINGS[5]) & combMask][1],
+                               comb1[(w - COMBTUNINGS[4]) & combMask][0]);
+
+        filterstore0 = eSimdAdd(eSimdMul(out0, damp2), eSimdMul(filterstore0, damp1));
+        filterstore1 = eSimdAdd(eSimdMul(out1, damp2), eSimdMul(filterstore1, damp1));
+        eSimdStore(eSimdFma(input, filterstore0, cmbFeedback), comb0[w & combMask]);
+        eSimdStore(eSimdFma(input, filterstore1, cmbFeedback), comb1[w & combMask]);
+
+        eF32 wetL = eSimdHorizontalSum(eSimdAdd(out0, out1));
+        eF32 wetR = wetL;
+
+        // 4 serial allpasses, right channel is spread a bit
+        for (eU32 j=0; j<TF_FX_REVERB_NUMALLPASSES; j++)
+        {
+            eF32 (*allpass)[2] = reverb->allpassBuffer[j];
+            eF32 bufL = allpass[(w - ALLPASSTUNINGS[j]) & allpassMask][LEFT];
+            eF32 bufR = allpass[(w - ALLPASSTUNINGS[j] - STEREOSPREAD) & allpassMask][RIGHT];
+            allpass[w & allpassMask][LEFT] = wetL + bufL * apsFeedback;
+            allpass[w & allpassMask][RIGHT] = wetR + bufR * apsFeedback;
+            wetL = bufL - wetL;
+            wetR = bufR - wetR;
+        }
 
-        eSimdStore2(out, *dryL++, *dryR++);
+        eF32 outL = wetL * wet1 + wetR * wet2 + dryL[i] * dry0;
+        eF32 outR = wetR * wet1 + wetL * wet2 + dryR[i] * dry0;
+        dryL[i] = outL;
+        dryR[i] = outR;
     }
+
+    eSimdStore(filterstore0, &reverb->filterstore[0]);
+    eSimdStore(filterstore1, &reverb->filterstore[4]);
+    reverb->writeOffset = w & combMask;
+}
+
+eF32 eTfEffectReverbTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    eF32 roomsize = input.params[TF_REVERB_ROOMSIZE] * SCALEROOM + OFFSETROOM;
+    eF32 combs = _eTfFeedbackTail((eF32)COMBTUNINGS[TF_FX_REVERB_NUMCOMBS-1] / input.sampleRate, roomsize);
+    eF32 allpasses = _eTfFeedbackTail((eF32)(ALLPASSTUNINGS[0] + STEREOSPREAD) / input.sampleRate, 0.5f);
+    return eMin(TF_EFFECT_MAXTAIL, combs + allpasses);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT DISTORTION
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectDistortionCreate()
+eTfEffect * eTfEffectDistortionCreate(eU32 sampleRate)
 {
     eTfEffectDistortion *dist = (eTfEffectDistortion *)eAllocAlignedAndZero(sizeof(eTfEffectDistortion), 16);
-    dist->generatedAmount = -1.0f;
+    dist->amount = -1.0f;
     return dist;
 }
 
@@ -334,41 +331,93 @@ void eTfEffectDistortionDelete(eTfEffect *fx)
     eFreeAligned(fx);
 }
 
-void eTfEffectDistortionProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+// sign(x) * min(|x|, 1)^amount, computed as 2^(amount*log2|x|)
+static eFORCEINLINE eF32x4 _eTfDistortionShape(eF32x4 x, eF32x4 amount)
+{
+    const eF32x4 signMask = _mm_castsi128_ps(_mm_set1_epi32(eSIMD_MSB1_REST0));
+    eF32x4 abs = eSimdAbs(x);
+    eF32x4 nonZero = _mm_cmpgt_ps(abs, eSimdZero());
+
+    abs = eSimdMin(eSimdMax(abs, eSimdSetAll(1e-20f)), eSimdSetAll(1.0f));
+    eF32x4 shaped = eSimdExp2(eSimdMul(amount, eSimdLog2(abs)));
+
+    return _mm_or_ps(_mm_and_ps(shaped, nonZero), _mm_and_ps(x, signMask));
+}
+
+void eTfEffectDistortionProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eASSERT_ALIGNED16(fx);
     eTfEffectDistortion *dist = (eTfEffectDistortion *)fx;
 
-    eF32 amount = 1.0f - instr.params[TF_DISTORT_AMOUNT];
-    if (amount != dist->generatedAmount)
-    {
-        dist->generatedAmount = amount;
-        for (eU32 base = 0; base<32768; base++)
-            dist->powTable[base] = ePow(base/32768.f, amount);
-    }
+    // ramp the exponent over the block, so automation doesn't zipper
+    eF32 amount = 1.0f - input.params[TF_DISTORT_AMOUNT];
+    eF32 prevAmount = dist->amount < 0.0f ? amount : dist->amount;
+    eF32 step = (amount - prevAmount) / (eF32)len;
+    dist->amount = amount;
+
+    const eF32x4 ramp = eSimdSet(4.0f, 3.0f, 2.0f, 1.0f);
+    const eF32x4 stepx4 = eSimdSetAll(step);
+    const eF32x4 step4x4 = eSimdSetAll(step * 4.0f);
 
     for(eU32 i=0;i<2;i++)
     {
         eF32 *in = signal[i];
-        eU32 len2 = len;
+        eF32x4 amountx4 = eSimdFma(eSimdSetAll(prevAmount), ramp, stepx4);
+        eU32 j = 0;
 
-        while(len2--)
+        for (; j+4<=len; j+=4)
         {
-            eF32 val = *in;
-            eF32 sign = eSign(val);
-            eF32 abs  = eAbs(val);
-            if (abs > 1.0f) abs = 1.0f;
-            eU32 offs = eFtoL(abs * 32767.0f);
-            *in++ = sign * dist->powTable[offs];
+            eSimdStore(_eTfDistortionShape(eSimdLoad(&in[j]), amountx4), &in[j]);
+            amountx4 = eSimdAdd(amountx4, step4x4);
+        }
+
+        if (j < len)
+        {
+            eALIGN16 eF32 rest[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (eU32 k=j; k<len; k++)
+                rest[k-j] = in[k];
+
+            eSimdStore(_eTfDistortionShape(eSimdLoad(rest), amountx4), rest);
+            for (eU32 k=j; k<len; k++)
+                in[k] = rest[k-j];
         }
     }
 }
 
+eF32 eTfEffectDistortionTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    return 0.0f;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT FORMANT
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectFormantCreate()
+// the original 10th order all-pole vowel filters, factored into
+// resonator sections sorted by frequency. each row holds (b1, b2)
+// of y = x + b1*y[-1] + b2*y[-2]. sections with the same index are
+// interpolated when morphing between vowels, linear interpolation
+// of (b1, b2) keeps stable sections stable.
+static constexpr eF32 FORMANT_GAIN[TF_FORMANTCOUNT] =
+{
+    3.110440e-06f, 4.362150e-06f, 3.338190e-06f, 1.135720e-06f, 4.094310e-07f
+};
+
+static constexpr eF32 FORMANT_SECTIONS[TF_FORMANTCOUNT][TF_FX_FORMANT_SECTIONS][2] =
+{
+    { { 1.9757972314f, -0.9884956748f }, { 1.9605214914f, -0.9874592552f }, { 1.8161322131f, -0.9830000202f }, // A
+      { 1.6834330414f, -0.9816709438f }, { 1.5077814247f, -0.9802475159f } },
+    { { 1.9890512505f, -0.9915212654f }, { 1.9055451301f, -0.9857448128f }, { 1.8274313366f, -0.9831507462f }, // E
+      { 1.6810003720f, -0.9788235156f }, { 1.5013550909f, -0.9719116265f } },
+    { { 1.9900208373f, -0.9914739647f }, { 1.8954662129f, -0.9873077343f }, { 1.8130771710f, -0.9858011660f }, // I
+      { 1.6846035023f, -0.9830683705f }, { 1.5099352425f, -0.9830455034f } },
+    { { 1.9862312195f, -0.9902319298f }, { 1.9754316101f, -0.9884907446f }, { 1.8266057130f, -0.9858890460f }, // O
+      { 1.6981470362f, -0.9816310499f }, { 1.5083185083f, -0.9809519883f } },
+    { { 1.9905871971f, -0.9926517058f }, { 1.9817555761f, -0.9917617475f }, { 1.8314934644f, -0.9760342585f }, // U
+      { 1.6921397153f, -0.9746940157f }, { 1.5013468100f, -0.9719052233f } },
+};
+
+eTfEffect * eTfEffectFormantCreate(eU32 sampleRate)
 {
     return eAllocAlignedAndZero(sizeof(eTfEffectFormant), 16);
 }
@@ -378,70 +427,69 @@ void eTfEffectFormantDelete(eTfEffect *fx)
     eFreeAligned(fx);
 }
 
-void eTfEffectFormantProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+void eTfEffectFormantProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eASSERT_ALIGNED16(fx);
     eTfEffectFormant *formant = (eTfEffectFormant *)fx;
 
-    const eF64 coeff[5][11]= {
-        { 3.11044e-06,
-            8.943665402,    -36.83889529,    92.01697887,    -154.337906,    181.6233289,
-            -151.8651235,   89.09614114,    -35.10298511,    8.388101016,    -0.923313471  ///A
-        },
-        {4.36215e-06,
-        8.90438318,    -36.55179099,    91.05750846,    -152.422234,    179.1170248,  ///E
-        -149.6496211,87.78352223,    -34.60687431,    8.282228154,    -0.914150747
-        },
-        { 3.33819e-06,
-        8.893102966,    -36.49532826,    90.96543286,    -152.4545478,    179.4835618,
-        -150.315433,    88.43409371,    -34.98612086,    8.407803364,    -0.932568035  ///I
-        },
-        {1.13572e-06,
-        8.994734087,    -37.2084849,    93.22900521,    -156.6929844,    184.596544,   ///O
-        -154.3755513,    90.49663749,    -35.58964535,    8.478996281,    -0.929252233
-        },
-        {4.09431e-07,
-        8.997322763,    -37.20218544,    93.11385476,    -156.2530937,    183.7080141,  ///U
-        -153.2631681,    89.59539726,    -35.12454591,    8.338655623,    -0.910251753
-        }
-    };
+    eF32 vowel         = eClamp<eF32>(0.0f, input.params[TF_FORMANT_MODE], 1.0f) * (TF_FORMANTCOUNT-1);
+    eU32 mode          = eMin<eU32>(eFtoL(vowel), TF_FORMANTCOUNT-2);
+    eF32 morph         = vowel - (eF32)mode;
+    eF32 wet           = input.params[TF_FORMANT_WET];
+    eF32 wet_inv       = 1.0f - wet;
 
-    eU32 mode          = eFtoL(instr.params[TF_FORMANT_MODE] * 4.0f);
-    eF32 wet           = instr.params[TF_FORMANT_WET];
-    eF32 wet_inv    = 1.0f - wet;
+    eF32x4 gain = eSimdSetAll(eLerp(FORMANT_GAIN[mode], FORMANT_GAIN[mode+1], morph));
+    eF32x4 b1[TF_FX_FORMANT_SECTIONS];
+    eF32x4 b2[TF_FX_FORMANT_SECTIONS];
+    eF32x4 y1[TF_FX_FORMANT_SECTIONS];
+    eF32x4 y2[TF_FX_FORMANT_SECTIONS];
 
-    const eF64 *co_vow = coeff[mode];
-    eF64 res = 0.0f;
-
-    for(eU32 i=0;i<2;i++)
+    for (eU32 j=0; j<TF_FX_FORMANT_SECTIONS; j++)
     {
-        eF32 *in = signal[i];
-        eF64 *mem = i==0 ? formant->memoryL : formant->memoryR;
+        b1[j] = eSimdSetAll(eLerp(FORMANT_SECTIONS[mode][j][0], FORMANT_SECTIONS[mode+1][j][0], morph));
+        b2[j] = eSimdSetAll(eLerp(FORMANT_SECTIONS[mode][j][1], FORMANT_SECTIONS[mode+1][j][1], morph));
+        y1[j] = eSimdLoad(formant->y1[j]);
+        y2[j] = eSimdLoad(formant->y2[j]);
+    }
 
-        eU32 len2 = len;
-        while (len2--)
-        {
-            res = co_vow[0] * (eF64)*in;
+    eF32 *inL = signal[LEFT];
+    eF32 *inR = signal[RIGHT];
+    eALIGN16 eF32 out[4];
 
-            for (eU32 j=0;j<TF_FX_FORMANT_MEMSIZE;j++)
-                res += co_vow[j+1] * mem[j];
+    for (eU32 i=0; i<len; i++)
+    {
+        eF32x4 res = eSimdMul(eSimdSet(0.0f, 0.0f, inR[i], inL[i]), gain);
 
-            for(eU32 j=TF_FX_FORMANT_MEMSIZE-1;j>0;j--)
-                mem[j] = mem[j-1];
+        for (eU32 j=0; j<TF_FX_FORMANT_SECTIONS; j++)
+        {
+            res = eSimdFma(eSimdFma(res, b1[j], y1[j]), b2[j], y2[j]);
+            y2[j] = y1[j];
+            y1[j] = res;
+        }
 
-            mem[0] = res;
+        eSimdStore(res, out);
+        inL[i] = inL[i] * wet_inv + out[0] * wet;
+        inR[i] = inR[i] * wet_inv + out[1] * wet;
+    }
 
-            *in *= wet_inv;
-            *in++ += (eF32)res * wet;
-        }
+    for (eU32 j=0; j<TF_FX_FORMANT_SECTIONS; j++)
+    {
+        eSimdStore(y1[j], formant->y1[j]);
+        eSimdStore(y2[j], formant->y2[j]);
     }
 }
 
+eF32 eTfEffectFormantTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    // the sharpest resonator has a pole radius of about 0.9963
+    return _eTfFeedbackTail(1.0f / input.sampleRate, 0.9963f);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT EQ
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectEqCreate()
+eTfEffect * eTfEffectEqCreate(eU32 sampleRate)
 {
     return eAllocAlignedAndZero(sizeof(eTfEffectEq), 16);
 }
@@ -451,7 +499,7 @@ void eTfEffectEqDelete(eTfEffect *fx)
     eFreeAligned(fx);
 }
 
-void eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+void eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eASSERT_ALIGNED16(fx);
     eTfEffectEq *eq = (eTfEffectEq *)fx;
@@ -459,14 +507,14 @@ void eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF
     eF32 gain[3];
     for(eU32 i=0;i<3;i++)
     {
-        gain[i] = instr.params[TF_EQ_LOW + i];
+        gain[i] = input.params[TF_EQ_LOW + i];
         if (gain[i] <= 0.5f)    gain[i] *= 2.0f;
         else                    gain[i] = ePow((gain[i] - 0.5f) * 2.0f, 2.0f) * 10.0f + 1.0f;
     }
 
     // Calculate filter cutoff frequencies
-    eF32 m_lf = 2.0f * eSin(ePI * (880.0f / synth.sampleRate));
-    eF32 m_hf = 2.0f * eSin(ePI * (5000.0f / synth.sampleRate));
+    eF32 m_lf = 2.0f * eSin(ePI * (880.0f / input.sampleRate));
+    eF32 m_hf = 2.0f * eSin(ePI * (5000.0f / input.sampleRate));
 
     eF32 *in1 = signal[0];
     eF32 *in2 = signal[1];
@@ -529,21 +577,33 @@ void eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF
     }
 }
 
+eF32 eTfEffectEqTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    // four cascaded one-poles at the low crossover
+    eF32 lf = 2.0f * eSin(ePI * (880.0f / input.sampleRate));
+    return 4.0f * _eTfFeedbackTail(1.0f / input.sampleRate, 1.0f - lf);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT CHORUS
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectChorusCreate()
+eTfEffect * eTfEffectChorusCreate(eU32 sampleRate)
 {
     eTfEffectChorus *chorus = (eTfEffectChorus *)eAllocAlignedAndZero(sizeof(eTfEffectChorus), 16);
     eRandom rand;
 
     rand.seedRandomly();
 
+    // room for the longest tap plus its interpolation neighbour
+    eU32 maxLen = eFtoL((eF32)sampleRate * TF_FX_CHORUS_DELAY_MAX / 1000.0f) + 2;
+    eTfDelayInit(chorus->line[LEFT], eTRUE, maxLen);
+    eTfDelayInit(chorus->line[RIGHT], eTRUE, maxLen);
+
     for(eU32 i=0; i<2*TF_FX_CHORUS_DELAYCOUNT; i++)
     {
-        eTfDelayInit(chorus->delay[i], eTRUE);
         chorus->lfoPhase[i] = rand.nextFloat();
+        chorus->delay[i] = -1.0f;
     }
 
     return chorus;
@@ -551,37 +611,55 @@ eTfEffect * eTfEffectChorusCreate()
 
 void eTfEffectChorusDelete(eTfEffect *fx)
 {
+    eTfEffectChorus *chorus = (eTfEffectChorus *)fx;
+    eTfDelayFree(chorus->line[LEFT]);
+    eTfDelayFree(chorus->line[RIGHT]);
     eFreeAligned(fx);
 }
 
-void eTfEffectChorusProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+void eTfEffectChorusProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eTfEffectChorus *chorus = (eTfEffectChorus *)fx;
 
-    eF32 depth = instr.params[TF_CHORUS_DEPTH];
-    eF32 gain = instr.params[TF_CHORUS_GAIN];
-    eF32 freq = instr.params[TF_CHORUS_RATE];
+    eF32 depth = input.params[TF_CHORUS_DEPTH];
+    eF32 gain = input.params[TF_CHORUS_GAIN];
+    eF32 freq = input.params[TF_CHORUS_RATE];
 
     const eF32 range = TF_FX_CHORUS_DELAY_MAX - TF_FX_CHORUS_DELAY_MIN;
-    freq = (freq * freq) / synth.sampleRate * len * 50.0f;
+    freq = (freq * freq) / input.sampleRate * len * 50.0f;
     gain *= 0.7f;
 
+    // tap delays glide from where the last block ended to the current LFO position
+    eF32 tapsFrom[2][TF_FX_CHORUS_DELAYCOUNT];
+    eF32 tapsTo[2][TF_FX_CHORUS_DELAYCOUNT];
+
     for(eU32 i=0; i<2 * TF_FX_CHORUS_DELAYCOUNT; i++)
     {
         eF32 sine = eSin(chorus->lfoPhase[i])+1.0f/2.0f;
         eF32 delay = (sine * depth * range) + TF_FX_CHORUS_DELAY_MIN;
         delay = eClamp<eF32>(TF_FX_CHORUS_DELAY_MIN, delay, TF_FX_CHORUS_DELAY_MAX);
-        eTfDelayUpdate(chorus->delay[i], synth.sampleRate, delay);
-        eTfDelayProcess(chorus->delay[i], signal[i%2], len, gain);
+        delay *= (eF32)input.sampleRate / 1000.0f;
+
+        tapsFrom[i%2][i/2] = (chorus->delay[i] < 0.0f ? delay : chorus->delay[i]);
+        tapsTo[i%2][i/2] = delay;
+        chorus->delay[i] = delay;
         chorus->lfoPhase[i] += freq;
     }
+
+    eTfDelayProcessTaps(chorus->line[LEFT], signal[LEFT], len, tapsFrom[LEFT], tapsTo[LEFT], TF_FX_CHORUS_DELAYCOUNT, gain);
+    eTfDelayProcessTaps(chorus->line[RIGHT], signal[RIGHT], len, tapsFrom[RIGHT], tapsTo[RIGHT], TF_FX_CHORUS_DELAYCOUNT, gain);
+}
+
+eF32 eTfEffectChorusTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    return TF_FX_CHORUS_DELAY_MAX / 1000.0f;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT FLANGER
 // ---------------------------------------------------------------------------------------------------------------------------
 
-eTfEffect * eTfEffectFlangerCreate()
+eTfEffect * eTfEffectFlangerCreate(eU32 sampleRate)
 {
     return (eTfEffectFlanger *)eAllocAlignedAndZero(sizeof(eTfEffectFlanger), 16);
 }
@@ -591,100 +669,520 @@ void eTfEffectFlangerDelete(eTfEffect *fx)
     eFreeAligned(fx);
 }
 
-void eTfEffectFlangerProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len)
+// advances the bidirectional LFO sweep by len samples and returns
+// the sum of the sweep values, which is what the LFO phase integrates
+static eF32 _eTfFlangerSweep(eTfEffectFlanger *flanger, eF32 step, eF32 top, eU32 len)
+{
+    eF32 sum = 0.0f;
+
+    while (len)
+    {
+        // number of samples until the sweep turns around
+        eF32 stepsLeft = (flanger->bidi == 0 ? top - flanger->lfocount : flanger->lfocount) / step;
+        eU32 run = (stepsLeft >= (eF32)len ? len : (stepsLeft > 0.0f ? (eU32)stepsLeft : 0));
+        eF32 dir = (flanger->bidi == 0 ? step : -step);
+
+        sum += (eF32)run * flanger->lfocount + dir * (eF32)(run * (run + 1) / 2);
+        flanger->lfocount += dir * (eF32)run;
+        len -= run;
+
+        if (len)
+        {
+            flanger->lfocount = (flanger->bidi == 0 ? 1.0f : 0.01f);
+            flanger->bidi ^= 1;
+            sum += flanger->lfocount;
+            len--;
+        }
+    }
+
+    return sum;
+}
+
+void eTfEffectFlangerProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
 {
     eTfEffectFlanger *flanger = (eTfEffectFlanger *)fx;
 
     eF32 *pcmleft  = signal[0];
     eF32 *pcmright = signal[1];
 
-    eF32 amp = instr.params[TF_FLANGER_AMPLITUDE];
-    eF32 freq = instr.params[TF_FLANGER_FREQUENCY];
-    eF32 lfo = instr.params[TF_FLANGER_LFO];
-    eF32 wet = instr.params[TF_FLANGER_WET];
+    eF32 amp = input.params[TF_FLANGER_AMPLITUDE];
+    eF32 freq = input.params[TF_FLANGER_FREQUENCY];
+    eF32 lfo = input.params[TF_FLANGER_LFO];
+    eF32 wet = input.params[TF_FLANGER_WET];
+
+    const eF32 DELAYMIN = (eF32)input.sampleRate * 0.1f / 1000.0f;    // 0.1 ms delay min
+    const eF32 DELAYMAX = (eF32)input.sampleRate *12.1f / 1000.0f;    // 12.1 ms delay max
+    const eF32 SWEEPRATE = ePI / (2.0f * (eF32)input.sampleRate);      // phase per sample while sweeping
+    const eF32 STATICRATE = SWEEPRATE / 120.0f;                       // phase per sample without LFO
+    eF32 step = lfo * 0.1f * (eF32)len;
+
+    // the LFO frequency is integrated over the block, then the
+    // oscillator runs at the resulting constant rate per block
+    eF32 omega[2];
+    if (step > 0.0f)
+    {
+        eF32 sum = _eTfFlangerSweep(flanger, step, freq, len);
+        omega[0] = SWEEPRATE * sum / (eF32)len;
+        omega[1] = SWEEPRATE * ((eF32)len - sum) / (eF32)len;
+    }
+    else
+    {
+        eF32 frequency = (flanger->lfocount == 0.0f ? 1.0f : flanger->lfocount);
+        omega[0] = omega[1] = STATICRATE * frequency;
+    }
 
-    const eF32 DELAYMIN = (eF32)synth.sampleRate * 0.1f / 1000.0f;    // 0.1 ms delay min
-    const eF32 DELAYMAX = (eF32)synth.sampleRate *12.1f / 1000.0f;    // 12.1 ms delay max
-    eF32 inc = 0.1f*(eF32)len;
+    // quadrature oscillator, re-seeded every block so it can't drift
+    eF32x4 cosPhase = eSimdSet(0.0f, 0.0f, eCos(flanger->phase[1]), eCos(flanger->phase[0]));
+    eF32x4 sinPhase = eSimdSet(0.0f, 0.0f, eSin(flanger->phase[1]), eSin(flanger->phase[0]));
+    const eF32x4 cosOmega = eSimdSet(1.0f, 1.0f, eCos(omega[1]), eCos(omega[0]));
+    const eF32x4 sinOmega = eSimdSet(0.0f, 0.0f, eSin(omega[1]), eSin(omega[0]));
 
-    while(len--)
+    for (eU32 i=0; i<2; i++)
+    {
+        flanger->phase[i] += omega[i] * (eF32)len;
+        flanger->phase[i] = eMod(flanger->phase[i], ePI * 2.0f);
+    }
+
+    const eF32x4 depth = eSimdSetAll((DELAYMAX - DELAYMIN) * amp * 0.5f);
+    const eF32x4 delayMin = eSimdSetAll(eMax(DELAYMIN, 1.0f));
+    const eF32x4 delayBase = eSimdSetAll(DELAYMIN);
+    const eF32x4 wetx4 = eSimdSetAll(wet);
+    const eF32x4 one = eSimdSetAll(1.0f);
+    const eF32x4 minusOne = eSimdSetAll(-1.0f);
+    const eU32 mask = TF_FX_FLANGERBUFFSIZE - 1;
+    eALIGN16 eF32 out[4];
+
+    for (eU32 i=0; i<len; i++)
+    {
+        eF32x4 c = eSimdSub(eSimdMul(cosPhase, cosOmega), eSimdMul(sinPhase, sinOmega));
+        sinPhase = eSimdAdd(eSimdMul(sinPhase, cosOmega), eSimdMul(cosPhase, sinOmega));
+        cosPhase = c;
+
+        // fractional delay taps, linearly interpolated
+        eF32x4 delay = eSimdMax(eSimdFma(delayBase, depth, eSimdSub(one, cosPhase)), delayMin);
+        // delays are at least one sample, so truncation is the floor
+        __m128i delayInt = _mm_cvttps_epi32(delay);
+        eF32x4 frac = eSimdSub(delay, _mm_cvtepi32_ps(delayInt));
+        __m128i tap = _mm_sub_epi32(_mm_set1_epi32(flanger->buffpos), delayInt);
+        eU32 tapL = (eU32)_mm_cvtsi128_si32(tap);
+        eU32 tapR = (eU32)_mm_cvtsi128_si32(_mm_shuffle_epi32(tap, 1));
+
+        eF32x4 near = eSimdSet(0.0f, 0.0f, flanger->buffer[tapR & mask][1], flanger->buffer[tapL & mask][0]);
+        eF32x4 far = eSimdSet(0.0f, 0.0f, flanger->buffer[(tapR - 1) & mask][1], flanger->buffer[(tapL - 1) & mask][0]);
+        eF32x4 delayed = eSimdFma(near, frac, eSimdSub(far, near));
+
+        eF32x4 in = eSimdSet(0.0f, 0.0f, pcmright[i], pcmleft[i]);
+        eF32x4 res = eSimdMin(eSimdMax(eSimdNfma(in, wetx4, delayed), minusOne), one);
+
+        _mm_storel_pi((__m64 *)flanger->buffer[flanger->buffpos], res);
+        flanger->buffpos = (flanger->buffpos + 1) & mask;
+
+        eSimdStore(res, out);
+        pcmleft[i] = out[0];
+        pcmright[i] = out[1];
+    }
+}
+
+eF32 eTfEffectFlangerTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    return _eTfFeedbackTail(12.1f / 1000.0f, input.params[TF_FLANGER_WET]);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+//  EFFECT CONVOLUTION
+// ---------------------------------------------------------------------------------------------------------------------------
+
+// splits the spectrum of left+i*right into the half spectra of
+// left and right, using the conjugate symmetry of real signals
+static void _eTfConvolutionSplit(const eF32 *fftBuffer, eF32 *spectrum)
+{
+    const eU32 n = TF_FX_CONV_FFTSIZE;
+
+    eF32 *leftRe = spectrum;
+    eF32 *leftIm = spectrum + TF_FX_CONV_BINS;
+    eF32 *rightRe = spectrum + TF_FX_CONV_BINS*2;
+    eF32 *rightIm = spectrum + TF_FX_CONV_BINS*3;
+
+    for (eU32 k=0; k<=n/2; k++)
     {
-        if (flanger->bidi==0)
+        const eU32 m = (n - k) & (n - 1);
+        const eF32 xr = fftBuffer[2*k];
+        const eF32 xi = fftBuffer[2*k+1];
+        const eF32 cr = fftBuffer[2*m];
+        const eF32 ci = -fftBuffer[2*m+1];
+
+        leftRe[k] = (xr + cr) * 0.5f;
+        leftIm[k] = (xi + ci) * 0.5f;
+        rightRe[k] = (xi - ci) * 0.5f;
+        rightIm[k] = (cr - xr) * 0.5f;
+    }
+
+    for (eU32 k=n/2+1; k<TF_FX_CONV_BINS; k++)
+        leftRe[k] = leftIm[k] = rightRe[k] = rightIm[k] = 0.0f;
+}
+
+static void _eTfConvolutionMultiplyAdd(eF32 *accu, const eF32 *x, const eF32 *h)
+{
+    for (eU32 ch=0; ch<2; ch++)
+    {
+        const eU32 re = ch*TF_FX_CONV_BINS*2;
+        const eU32 im = re + TF_FX_CONV_BINS;
+
+        for (eU32 k=0; k<TF_FX_CONV_BINS; k+=4)
         {
-            flanger->lfocount += lfo * inc;
+            const eF32x4 xr = eSimdLoadAligned(&x[re+k]);
+            const eF32x4 xi = eSimdLoadAligned(&x[im+k]);
+            const eF32x4 hr = eSimdLoadAligned(&h[re+k]);
+            const eF32x4 hi = eSimdLoadAligned(&h[im+k]);
+
+            eF32x4 ar = eSimdLoadAligned(&accu[re+k]);
+            eF32x4 ai = eSimdLoadAligned(&accu[im+k]);
+            ar = eSimdNfma(eSimdFma(ar, xr, hr), xi, hi);
+            ai = eSimdFma(eSimdFma(ai, xr, hi), xi, hr);
+            eSimdStoreAligned(ar, &accu[re+k]);
+            eSimdStoreAligned(ai, &accu[im+k]);
+        }
+    }
+}
 
-            if (flanger->lfocount > freq)
-            {
-                flanger->lfocount = 1.0f;
-                flanger->bidi = 1;
-            }
+static void _eTfConvolutionRunBlock(eTfSynth &synth, eTfEffectConvolution &conv, const eTfConvolutionIr &ir)
+{
+    const eU32 n = TF_FX_CONV_FFTSIZE;
+    eF32 *fftBuffer = conv.fftBuffer;
+
+    // transform the last two blocks of input into the delay line
+    for (eU32 i=0; i<n; i++)
+    {
+        fftBuffer[2*i] = conv.input[0][i];
+        fftBuffer[2*i+1] = conv.input[1][i];
+    }
+
+    eTfGeneratorFft(synth, FFT, n, fftBuffer);
+    _eTfConvolutionSplit(fftBuffer, &conv.fdl[conv.fdlPos*TF_FX_CONV_SPECTRUMSIZE]);
+
+    // input spectrum of p blocks ago meets IR partition p
+    eMemSet(conv.accu, 0, sizeof(conv.accu));
+
+    const eU32 partitions = eMin(ir.partitions, conv.maxPartitions);
+    eU32 slot = conv.fdlPos;
+
+    for (eU32 p=0; p<partitions; p++)
+    {
+        _eTfConvolutionMultiplyAdd(conv.accu, &conv.fdl[slot*TF_FX_CONV_SPECTRUMSIZE], &ir.spectra[p*TF_FX_CONV_SPECTRUMSIZE]);
+        slot = (slot == 0 ? conv.maxPartitions : slot) - 1;
+    }
+
+    // merge both half spectra back into one complex spectrum
+    const eF32 *leftRe = conv.accu;
+    const eF32 *leftIm = conv.accu + TF_FX_CONV_BINS;
+    const eF32 *rightRe = conv.accu + TF_FX_CONV_BINS*2;
+    const eF32 *rightIm = conv.accu + TF_FX_CONV_BINS*3;
+
+    for (eU32 k=0; k<=n/2; k++)
+    {
+        fftBuffer[2*k] = leftRe[k] - rightIm[k];
+        fftBuffer[2*k+1] = leftIm[k] + rightRe[k];
+    }
+
+    for (eU32 k=n/2+1; k<n; k++)
+    {
+        const eU32 m = n - k;
+        fftBuffer[2*k] = leftRe[m] + rightIm[m];
+        fftBuffer[2*k+1] = rightRe[m] - leftIm[m];
+    }
+
+    eTfGeneratorFft(synth, IFFT, n, fftBuffer);
+
+    // overlap-save: the first half is circular garbage
+    for (eU32 i=0; i<TF_FX_CONV_PARTSIZE; i++)
+    {
+        conv.output[0][i] = fftBuffer[2*(TF_FX_CONV_PARTSIZE+i)];
+        conv.output[1][i] = fftBuffer[2*(TF_FX_CONV_PARTSIZE+i)+1];
+    }
+
+    for (eU32 ch=0; ch<2; ch++)
+        eMemCopy(conv.input[ch], &conv.input[ch][TF_FX_CONV_PARTSIZE], TF_FX_CONV_PARTSIZE*sizeof(eF32));
+
+    conv.fdlPos = (conv.fdlPos + 1) % conv.maxPartitions;
+}
+
+eTfConvolutionIr * eTfConvolutionIrCreate(eTfSynth &synth, const eF32 *left, const eF32 *right, eU32 length, eU32 sampleRate)
+{
+    length = eMin(length, (eU32)(TF_FX_CONV_MAXSECONDS * sampleRate));
+
+    eTfConvolutionIr *ir = (eTfConvolutionIr *)eAllocAlignedAndZero(sizeof(eTfConvolutionIr), 16);
+    ir->sampleRate = sampleRate;
+    ir->length = length;
+    ir->partitions = (length + TF_FX_CONV_PARTSIZE - 1) / TF_FX_CONV_PARTSIZE;
+    ir->spectra = (eF32 *)eAllocAlignedAndZero(eMax(ir->partitions, 1U) * TF_FX_CONV_SPECTRUMSIZE * sizeof(eF32), 16);
+
+    // normalized to unit energy so the wet level doesn't depend on the
+    // file, the inverse FFT's 1/n is folded in here as well
+    eF32 energy = 0.0f;
+    for (eU32 i=0; i<length; i++)
+        energy += (left[i]*left[i] + right[i]*right[i]) * 0.5f;
+
+    const eF32 scale = (energy > 0.0f ? 1.0f / eSqrt(energy) : 0.0f) / TF_FX_CONV_FFTSIZE;
+
+    eF32 *fftBuffer = (eF32 *)eAllocAlignedAndZero(TF_FX_CONV_FFTSIZE * 2 * sizeof(eF32), 16);
+
+    for (eU32 p=0; p<ir->partitions; p++)
+    {
+        eMemSet(fftBuffer, 0, TF_FX_CONV_FFTSIZE * 2 * sizeof(eF32));
+
+        const eU32 offset = p * TF_FX_CONV_PARTSIZE;
+        const eU32 count = eMin(TF_FX_CONV_PARTSIZE, length - offset);
+
+        for (eU32 i=0; i<count; i++)
+        {
+            fftBuffer[2*i] = left[offset+i] * scale;
+            fftBuffer[2*i+1] = right[offset+i] * scale;
         }
-        else
+
+        eTfGeneratorFft(synth, FFT, TF_FX_CONV_FFTSIZE, fftBuffer);
+        _eTfConvolutionSplit(fftBuffer, &ir->spectra[p*TF_FX_CONV_SPECTRUMSIZE]);
+    }
+
+    eFreeAligned(fftBuffer);
+    return ir;
+}
+
+void eTfConvolutionIrFree(eTfConvolutionIr *ir)
+{
+    if (ir == nullptr)
+        return;
+
+    eFreeAligned(ir->spectra);
+    eFreeAligned(ir);
+}
+
+void eTfConvolutionIrExchangeInit(eTfConvolutionIrExchange &exchange)
+{
+    exchange.current = nullptr;
+    exchange.currentLength = 0;
+    exchange.currentSampleRate = 0;
+}
+
+void eTfConvolutionIrExchangeFree(eTfConvolutionIrExchange &exchange)
+{
+    eTfConvolutionIrExchangeCollect(exchange);
+
+    eTfConvolutionIr *ir;
+    while (exchange.incoming.pop(ir))
+        eTfConvolutionIrFree(ir);
+
+    eTfConvolutionIrFree(exchange.current);
+    eTfConvolutionIrExchangeInit(exchange);
+}
+
+eBool eTfConvolutionIrExchangePublish(eTfConvolutionIrExchange &exchange, eTfConvolutionIr *ir)
+{
+    eTfConvolutionIrExchangeCollect(exchange);
+    return exchange.incoming.push(ir);
+}
+
+void eTfConvolutionIrExchangeCollect(eTfConvolutionIrExchange &exchange)
+{
+    eTfConvolutionIr *ir;
+    while (exchange.retired.pop(ir))
+        eTfConvolutionIrFree(ir);
+}
+
+eTfConvolutionIr * eTfConvolutionIrExchangeFetch(eTfConvolutionIrExchange &exchange)
+{
+    eTfConvolutionIr *ir;
+    while (exchange.incoming.pop(ir))
+    {
+        // the retired queue only fills up if the loader
+        // stalls. freeing here is the lesser evil than leaking.
+        if (exchange.current && !exchange.retired.push(exchange.current))
+            eTfConvolutionIrFree(exchange.current);
+
+        exchange.current = ir;
+        exchange.currentLength = ir ? ir->length : 0;
+        exchange.currentSampleRate = ir ? ir->sampleRate : 0;
+    }
+
+    return exchange.current;
+}
+
+eTfEffect * eTfEffectConvolutionCreate(eU32 sampleRate)
+{
+    eTfEffectConvolution *conv = (eTfEffectConvolution *)eAllocAlignedAndZero(sizeof(eTfEffectConvolution), 16);
+    conv->maxPartitions = eFtoL(TF_FX_CONV_MAXSECONDS * sampleRate) / TF_FX_CONV_PARTSIZE + 1;
+    conv->fdl = (eF32 *)eAllocAlignedAndZero(conv->maxPartitions * TF_FX_CONV_SPECTRUMSIZE * sizeof(eF32), 16);
+    return conv;
+}
+
+void eTfEffectConvolutionDelete(eTfEffect *fx)
+{
+    eTfEffectConvolution *conv = (eTfEffectConvolution *)fx;
+    eFreeAligned(conv->fdl);
+    eFreeAligned(conv);
+}
+
+void eTfEffectConvolutionProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len)
+{
+    eASSERT_ALIGNED16(fx);
+    eTfEffectConvolution *conv = (eTfEffectConvolution *)fx;
+
+    if (input.convolutionIr == nullptr)
+        return;
+
+    const eTfConvolutionIr *ir = eTfConvolutionIrExchangeFetch(*input.convolutionIr);
+    if (ir == nullptr)
+        return;
+
+    const eF32 wet = input.params[TF_CONV_WET];
+    const eF32 dry = 1.0f - wet;
+
+    eU32 done = 0;
+    while (done < len)
+    {
+        const eU32 run = eMin(len - done, TF_FX_CONV_PARTSIZE - conv->fill);
+
+        for (eU32 ch=0; ch<2; ch++)
         {
-            flanger->lfocount -= lfo * inc;
+            eF32 *in = &conv->input[ch][TF_FX_CONV_PARTSIZE + conv->fill];
+            const eF32 *out = &conv->output[ch][conv->fill];
+            eF32 *sig = &signal[ch][done];
 
-            if (flanger->lfocount < 0.0f)
+            for (eU32 i=0; i<run; i++)
             {
-                flanger->lfocount = 0.01f;
-                flanger->bidi = 0;
+                in[i] = sig[i];
+                sig[i] = sig[i] * dry + out[i] * wet;
             }
         }
 
-        eF32 frequency = flanger->lfocount;
-
-        if (frequency==0.0)
-            frequency=1.0f;
+        conv->fill += run;
+        done += run;
 
-        if(flanger->lastBpm != frequency)
+        if (conv->fill == TF_FX_CONV_PARTSIZE)
         {
-            flanger->angle0 += (eF32)((eF64)flanger->angle * frequency * 120.0f / (synth.sampleRate * 4.0f * 60.0f / ePI));
-            flanger->angle1 += (eF32)((eF64)flanger->angle * (1.0f - frequency) * 120.0f / (synth.sampleRate * 4.0f * 60.0f / ePI));
-            flanger->lastBpm = frequency;
-            flanger->angle = 0;
+            _eTfConvolutionRunBlock(synth, *conv, *ir);
+            conv->fill = 0;
         }
+    }
+}
+
+eF32 eTfEffectConvolutionTail(eTfSynth &synth, const eTfEffectInput &input)
+{
+    if (input.convolutionIr == nullptr)
+        return 0.0f;
 
-        eInt deltaleft = eFtoL(DELAYMIN + ((DELAYMAX - DELAYMIN) / 8192.0f) * amp * 4096.0f * (1.0f - eCos(flanger->angle0 + flanger->angle * frequency / (synth.sampleRate * 4 * 60 / ePI))));
-        eInt deltaright = eFtoL(DELAYMIN + ((DELAYMAX - DELAYMIN) / 8192.0f) * amp * 4096.0f * (1.0f - eCos(flanger->angle1 + flanger->angle * frequency / (synth.sampleRate * 4 * 60 / ePI))));
+    const eU32 sampleRate = input.convolutionIr->currentSampleRate;
+    if (sampleRate == 0)
+        return 0.0f;
 
-        flanger->angle++;
+    return (eF32)(input.convolutionIr->currentLength + TF_FX_CONV_PARTSIZE) / sampleRate;
+}
 
-        eInt ppleft = flanger->buffpos - deltaleft;
-        eInt ppright = flanger->buffpos - deltaright;
+// ---------------------------------------------------------------------------------------------------------------------------
+//  EFFECT POOL
+// ---------------------------------------------------------------------------------------------------------------------------
 
-        if(ppleft<0)
-            ppleft += TF_FX_FLANGERBUFFSIZE;
+void eTfEffectPoolInit(eTfEffectPool &pool, eU32 sampleRate)
+{
+    pool.sampleRate = sampleRate;
 
-        if(ppright<0)
-            ppright += TF_FX_FLANGERBUFFSIZE;
+    for (eU32 i=0; i<FX_COUNT; i++)
+    {
+        pool.spare[i] = s_effectCreate[i] ? s_effectCreate[i](sampleRate) : nullptr;
+        pool.requested[i] = eFALSE;
+    }
+}
 
-        eF32 l = *pcmleft - wet * flanger->buffleft[ppleft];
+void eTfEffectPoolFree(eTfEffectPool &pool)
+{
+    eTfEffectPoolService(pool);
 
-        if (l<-1.0f)
-            l=-1.0f;
-        else if (l>1.0f)
-            l=1.0f;
+    eTfEffectPoolItem item;
+    while (pool.ready.pop(item))
+        s_effectDelete[item.fxIndex](item.fx);
 
-        eF32 r = *pcmright - wet * flanger->buffright[ppright];
+    for (eU32 i=0; i<FX_COUNT; i++)
+    {
+        if (pool.spare[i])
+            s_effectDelete[i](pool.spare[i]);
 
-        if (r<-1.0f)
-            r=-1.0f;
-        else if (r>1.0f)
-            r=1.0f;
+        pool.spare[i] = nullptr;
+        pool.requested[i] = eFALSE;
+    }
+}
 
-        eUndenormalise(l);
-        eUndenormalise(r);
+void eTfEffectPoolService(eTfEffectPool &pool)
+{
+    eTfEffectPoolItem item;
+    while (pool.retired.pop(item))
+        s_effectDelete[item.fxIndex](item.fx);
 
-        *pcmleft = l;
-        *pcmright = r;
+    while (pool.requests.pop(item))
+    {
+        item.fx = s_effectCreate[item.fxIndex](item.sampleRate);
 
-        flanger->buffleft[flanger->buffpos] = l;
-        flanger->buffright[flanger->buffpos] = r;
+        // can't overflow, there's at most one request per effect type in flight
+        if (!pool.ready.push(item))
+            s_effectDelete[item.fxIndex](item.fx);
+    }
+}
 
-        pcmleft++;
-        pcmright++;
-        flanger->buffpos++;
+eTfEffect * eTfEffectPoolAcquire(eTfEffectPool &pool, eU32 fxIndex, eU32 sampleRate)
+{
+    eASSERT(fxIndex < FX_COUNT && s_effectCreate[fxIndex]);
 
-        if (flanger->buffpos >= TF_FX_FLANGERBUFFSIZE)
-            flanger->buffpos = 0;
+    // effect buffers are sized for the sample rate,
+    // so spares built for another rate are useless
+    if (sampleRate != pool.sampleRate)
+    {
+        for (eU32 i=0; i<FX_COUNT; i++)
+        {
+            if (pool.spare[i])
+                eTfEffectPoolRelease(pool, i, pool.spare[i]);
+
+            pool.spare[i] = nullptr;
+        }
+
+        pool.sampleRate = sampleRate;
     }
+
+    eTfEffectPoolItem item;
+    while (pool.ready.pop(item))
+    {
+        pool.requested[item.fxIndex] = eFALSE;
+
+        if (item.sampleRate == pool.sampleRate && pool.spare[item.fxIndex] == nullptr)
+            pool.spare[item.fxIndex] = item.fx;
+        else
+            eTfEffectPoolRelease(pool, item.fxIndex, item.fx);
+    }
+
+    eTfEffect *fx = pool.spare[fxIndex];
+    pool.spare[fxIndex] = nullptr;
+
+    // ask for a replacement, so the next slot switching
+    // to this effect type finds an instance waiting
+    if (!pool.requested[fxIndex])
+    {
+        item.fxIndex = fxIndex;
+        item.sampleRate = pool.sampleRate;
+        item.fx = nullptr;
+
+        if (pool.requests.push(item))
+            pool.requested[fxIndex] = eTRUE;
+    }
+
+    return fx;
+}
+
+void eTfEffectPoolRelease(eTfEffectPool &pool, eU32 fxIndex, eTfEffect *fx)
+{
+    eTfEffectPoolItem item;
+    item.fxIndex = fxIndex;
+    item.sampleRate = 0;
+    item.fx = fx;
+
+    // the retired queue only fills up if the service thread
+    // stalls. deleting here is the lesser evil than leaking.
+    if (!pool.retired.push(item))
+        s_effectDelete[fxIndex](fx);
 }
@@ -29,49 +29,28 @@
 
 struct eTfLfo;
 struct eTfSynth;
-struct eTfInstrument;
+struct eTfEffectInput;
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT COMPONENTS
 // ---------------------------------------------------------------------------------------------------------------------------
 
-const eU32 TF_DELAY_MAXLEN   = 192000;
-const eU32 TF_COMB_MAXLEN    = 4096;
-const eU32 TF_ALLPASS_MAXLEN = 4096;
-
+// ring buffer capacity is the maximum delay rounded up to a power
+// of 2. the write offset runs freely, reads happen at writeOffset-delayLen.
 struct eTfDelay
 {
     eBool    singleDelay;
-    eF32     delayBuffer[TF_DELAY_MAXLEN];
+    eF32 *   delayBuffer;
+    eU32     delayMask;
     eU32     delayLen;
-    eU32     readOffset;
     eU32     writeOffset;
 };
 
-struct eTfComb
-{
-    eF32    buffer[TF_COMB_MAXLEN];
-    eInt    bufsize;
-    eInt    bufidx;
-	eF32    filterstore;
-};
-
-struct eTfAllpass
-{
-    eF32    buffer[TF_ALLPASS_MAXLEN];
-    eInt    bufsize;
-    eInt    bufidx;
-};
-
-void eTfDelayInit(eTfDelay &delay, eBool singleDelay);
+void eTfDelayInit(eTfDelay &delay, eBool singleDelay, eU32 maxLen);
+void eTfDelayFree(eTfDelay &delay);
 void eTfDelayUpdate(eTfDelay &delay, eU32 sampleRate, eF32 ms);
 void eTfDelayProcess(eTfDelay &delay, eF32 *signal, eU32 len, eF32 decay);
-
-void eTfCombInit(eTfComb &comb, eU32 size);
-void eTfCombProcess(eTfComb &comb1, eTfComb &comb2, eF32 damp1, eF32 damp2, eF32 feedback, eF32 gain, eF32 **signals_in, eF32 **signals_out, eU32 len);
-
-void eTfAllpassInit(eTfAllpass &allpass, eU32 size);
-void eTfAllpassProcess(eTfAllpass &allpass1, eTfAllpass &allpass2, eF32 feedback, eF32 **signals_in, eF32 **signals_out, eU32 len);
+void eTfDelayProcessTaps(eTfDelay &delay, eF32 *signal, eU32 len, const eF32 *tapsFrom, const eF32 *tapsTo, eU32 tapCount, eF32 gain);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT INTERFACE
@@ -87,7 +66,7 @@ enum eTfFxMode
     FX_REVERB,
     FX_FORMANT,
     FX_EQ,
-    FX_RESERVED6,
+    FX_CONVOLUTION,
     FX_RESERVED7,
     FX_RESERVED8,
 
@@ -95,9 +74,17 @@ enum eTfFxMode
 };
 
 typedef void        eTfEffect;
-typedef eTfEffect * (*eTfEffectCreateProc)();
+typedef eTfEffect * (*eTfEffectCreateProc)(eU32 sampleRate);
 typedef void        (*eTfEffectDeleteProc)(eTfEffect *fx);
-typedef void        (*eTfEffectProcessProc)(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+typedef void        (*eTfEffectProcessProc)(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+typedef eF32        (*eTfEffectTailProc)(eTfSynth &synth, const eTfEffectInput &input);
+
+// an effect goes to sleep once its input stayed below TF_EFFECT_SILENCE
+// for as long as its tail (the time its state needs to decay by
+// TF_EFFECT_SILENCE, derived from the current parameters) and its output
+// is below TF_EFFECT_SILENCE too. any input above it wakes the effect.
+const eF32          TF_EFFECT_SILENCE   = 1e-5f;    // -100 dB
+const eF32          TF_EFFECT_MAXTAIL   = 30.0f;    // seconds
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT DELAY
@@ -110,9 +97,10 @@ struct eTfEffectDelay
     eTfDelay    delay[2];
 };
 
-eTfEffect *     eTfEffectDelayCreate();
+eTfEffect *     eTfEffectDelayCreate(eU32 sampleRate);
 void            eTfEffectDelayDelete(eTfEffect *fx);
-void            eTfEffectDelayProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectDelayProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectDelayTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT REVERB
@@ -120,50 +108,56 @@ void            eTfEffectDelayProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrum
 
 const eU32      TF_FX_REVERB_NUMCOMBS     = 8;
 const eU32      TF_FX_REVERB_NUMALLPASSES = 4;
+const eU32      TF_FX_REVERB_COMBSIZE     = 2048; // power of 2 > longest comb
+const eU32      TF_FX_REVERB_ALLPASSSIZE  = 1024; // power of 2 > longest allpass
 
+// left and right comb filters are tuned identically and see the same mono
+// input, so only one bank of 8 combs is run. the combs are interleaved in
+// groups of 4, one SIMD lane each, and share a single write offset.
 struct eTfEffectReverb
 {
-    eTfComb     comb[2][TF_FX_REVERB_NUMCOMBS];
-    eTfAllpass  allpass[2][TF_FX_REVERB_NUMALLPASSES];
-    eF32        combBuffers[TF_FX_REVERB_NUMCOMBS*2*TF_MAXFRAMESIZE];
-    eF32        mixBuffers[TF_MAXFRAMESIZE*2];
+    eF32        combBuffer[TF_FX_REVERB_NUMCOMBS/4][TF_FX_REVERB_COMBSIZE][4];
+    eF32        allpassBuffer[TF_FX_REVERB_NUMALLPASSES][TF_FX_REVERB_ALLPASSSIZE][2];
+    eF32        filterstore[TF_FX_REVERB_NUMCOMBS];
+    eU32        writeOffset;
 };
 
-eTfEffect *     eTfEffectReverbCreate();
+eTfEffect *     eTfEffectReverbCreate(eU32 sampleRate);
 void            eTfEffectReverbDelete(eTfEffect *fx);
-void            eTfEffectReverbProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectReverbProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectReverbTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT DISTORTION
 // ---------------------------------------------------------------------------------------------------------------------------
 
-const eU32        TF_FX_DISTORTION_TABLESIZE = 32768;
-
 struct eTfEffectDistortion
 {
-    eF32        generatedAmount;
-    eF32        powTable[TF_FX_DISTORTION_TABLESIZE];
+    eF32        amount;
 };
 
-eTfEffect *     eTfEffectDistortionCreate();
+eTfEffect *     eTfEffectDistortionCreate(eU32 sampleRate);
 void            eTfEffectDistortionDelete(eTfEffect *fx);
-void            eTfEffectDistortionProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectDistortionProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectDistortionTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT FORMANT
 // ---------------------------------------------------------------------------------------------------------------------------
 
-const eU32      TF_FX_FORMANT_MEMSIZE = 10;
+const eU32      TF_FX_FORMANT_SECTIONS = 5;
 
+// cascade of 5 two-pole resonators, left and right run in SIMD lanes 0 and 1
 struct eTfEffectFormant
 {
-    eF64        memoryL[TF_FX_FORMANT_MEMSIZE];
-    eF64        memoryR[TF_FX_FORMANT_MEMSIZE];
+    eF32        y1[TF_FX_FORMANT_SECTIONS][4];
+    eF32        y2[TF_FX_FORMANT_SECTIONS][4];
 };
 
-eTfEffect *     eTfEffectFormantCreate();
+eTfEffect *     eTfEffectFormantCreate(eU32 sampleRate);
 void            eTfEffectFormantDelete(eTfEffect *fx);
-void            eTfEffectFormantProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectFormantProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectFormantTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT EQ
@@ -189,27 +183,31 @@ struct eTfEffectEq
     eF32x2      m_sdm3;     //                   3
 };
 
-eTfEffect *     eTfEffectEqCreate();
+eTfEffect *     eTfEffectEqCreate(eU32 sampleRate);
 void            eTfEffectEqDelete(eTfEffect *fx);
-void            eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectEqProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectEqTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT CHORUS
 // ---------------------------------------------------------------------------------------------------------------------------
 
-const eU32      TF_FX_CHORUS_DELAYCOUNT = 3;
+const eU32      TF_FX_CHORUS_DELAYCOUNT = 3; // taps per channel, at most 4
 const eF32      TF_FX_CHORUS_DELAY_MAX = 10.0f;
 const eF32      TF_FX_CHORUS_DELAY_MIN = 1.0f;
 
+// one delay line per channel, read by all of its taps in a single pass
 struct eTfEffectChorus
 {
-    eTfDelay    delay[2*TF_FX_CHORUS_DELAYCOUNT];
+    eTfDelay    line[2];
     eF32        lfoPhase[2*TF_FX_CHORUS_DELAYCOUNT];
+    eF32        delay[2*TF_FX_CHORUS_DELAYCOUNT];
 };
 
-eTfEffect *     eTfEffectChorusCreate();
+eTfEffect *     eTfEffectChorusCreate(eU32 sampleRate);
 void            eTfEffectChorusDelete(eTfEffect *fx);
-void            eTfEffectChorusProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectChorusProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectChorusTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  EFFECT FLANGER
@@ -217,26 +215,95 @@ void            eTfEffectChorusProcess(eTfEffect *fx, eTfSynth &synth, eTfInstru
 
 const eU32  TF_FX_FLANGERBUFFSIZE      = 4096;
 
+// left and right share one LFO generator running in SIMD lanes 0 and 1,
+// the delay line stores interleaved left/right pairs
 struct eTfEffectFlanger
 {
     eInt        buffpos;
     eInt        bidi;
-    eF32        buffleft[TF_FX_FLANGERBUFFSIZE*2];
-    eF32        buffright[TF_FX_FLANGERBUFFSIZE*2];
-    eInt        depth;
-    eInt        targetDepth;
-    eInt        volume;
-    eInt        targetVolume;
-    eInt        angle;
-    eF32        angle0;
-    eF32        angle1;
     eF32        lfocount;
-    eF32        lastBpm;
+    eF32        phase[2];
+    eF32        buffer[TF_FX_FLANGERBUFFSIZE][2];
 };
 
-eTfEffect *     eTfEffectFlangerCreate();
+eTfEffect *     eTfEffectFlangerCreate(eU32 sampleRate);
 void            eTfEffectFlangerDelete(eTfEffect *fx);
-void            eTfEffectFlangerProcess(eTfEffect *fx, eTfSynth &synth, eTfInstrument &instr, eF32 **signal, eU32 len);
+void            eTfEffectFlangerProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectFlangerTail(eTfSynth &synth, const eTfEffectInput &input);
+
+// ---------------------------------------------------------------------------------------------------------------------------
+//  EFFECT CONVOLUTION
+// ---------------------------------------------------------------------------------------------------------------------------
+
+// uniformly partitioned overlap-save convolution. the impulse response is
+// cut into partitions of TF_FX_CONV_PARTSIZE samples which are transformed
+// once when it's loaded, each block of input is transformed once and kept
+// in a frequency-domain delay line. a block costs two FFTs plus one complex
+// multiply-add per partition and bin, independent of the IR's content. left
+// and right travel in the real and imaginary part of the same complex FFT.
+// the wet signal trails the input by one partition.
+
+const eU32      TF_FX_CONV_PARTSIZE     = 256;
+const eU32      TF_FX_CONV_FFTSIZE      = TF_FX_CONV_PARTSIZE*2;
+const eU32      TF_FX_CONV_BINS         = TF_FX_CONV_PARTSIZE+4; // FFTSIZE/2+1, padded to SIMD width
+const eU32      TF_FX_CONV_SPECTRUMSIZE = 2*2*TF_FX_CONV_BINS;   // left/right, re/im
+const eF32      TF_FX_CONV_MAXSECONDS   = 4.0f;                  // longer IRs are cut
+const eU32      TF_FX_CONV_QUEUESIZE    = 4;
+
+// pre-transformed impulse response, immutable once built
+struct eTfConvolutionIr
+{
+    eU32        sampleRate;
+    eU32        length;
+    eU32        partitions;
+    eF32 *      spectra;    // [partitions][TF_FX_CONV_SPECTRUMSIZE]
+};
+
+// impulse responses are built and freed by a loader thread. new ones
+// and retired ones are handed over through lock-free queues, so the
+// audio thread never allocates, frees or waits for a file.
+struct eTfConvolutionIrExchange
+{
+    // owned by the audio thread
+    eTfConvolutionIr *  current;
+
+    // readable by any thread, for the tail length
+    std::atomic<eU32>   currentLength;
+    std::atomic<eU32>   currentSampleRate;
+
+    // loader thread -> audio thread
+    eLockFreeQueue<eTfConvolutionIr *, TF_FX_CONV_QUEUESIZE>    incoming;
+
+    // audio thread -> loader thread
+    eLockFreeQueue<eTfConvolutionIr *, TF_FX_CONV_QUEUESIZE>    retired;
+};
+
+eTfConvolutionIr *  eTfConvolutionIrCreate(eTfSynth &synth, const eF32 *left, const eF32 *right, eU32 length, eU32 sampleRate);
+void                eTfConvolutionIrFree(eTfConvolutionIr *ir);
+
+void                eTfConvolutionIrExchangeInit(eTfConvolutionIrExchange &exchange);
+void                eTfConvolutionIrExchangeFree(eTfConvolutionIrExchange &exchange);
+eBool               eTfConvolutionIrExchangePublish(eTfConvolutionIrExchange &exchange, eTfConvolutionIr *ir);
+void                eTfConvolutionIrExchangeCollect(eTfConvolutionIrExchange &exchange);
+eTfConvolutionIr *  eTfConvolutionIrExchangeFetch(eTfConvolutionIrExchange &exchange);
+
+// accu is accessed with aligned SIMD loads and must stay first
+struct eTfEffectConvolution
+{
+    eF32        accu[TF_FX_CONV_SPECTRUMSIZE];
+    eF32        input[2][TF_FX_CONV_FFTSIZE];
+    eF32        output[2][TF_FX_CONV_PARTSIZE];
+    eF32        fftBuffer[TF_FX_CONV_FFTSIZE*2];
+    eF32 *      fdl;        // [maxPartitions][TF_FX_CONV_SPECTRUMSIZE], input spectra
+    eU32        maxPartitions;
+    eU32        fdlPos;
+    eU32        fill;
+};
+
+eTfEffect *     eTfEffectConvolutionCreate(eU32 sampleRate);
+void            eTfEffectConvolutionDelete(eTfEffect *fx);
+void            eTfEffectConvolutionProcess(eTfEffect *fx, eTfSynth &synth, const eTfEffectInput &input, eF32 **signal, eU32 len);
+eF32            eTfEffectConvolutionTail(eTfSynth &synth, const eTfEffectInput &input);
 
 // ---------------------------------------------------------------------------------------------------------------------------
 //  FUNCTION POINTERS
@@ -280,7 +347,11 @@ static eTfEffectCreateProc s_effectCreate[] =
 #else
     nullptr,
 #endif
-    nullptr,   // FX_RESERVED6
+#ifndef eCFG_NO_TF_FX_CONVOLUTION
+    eTfEffectConvolutionCreate,
+#else
+    nullptr,
+#endif
     nullptr,   // FX_RESERVED7
     nullptr,   // FX_RESERVED8
 };
@@ -323,7 +394,11 @@ static eTfEffectDeleteProc s_effectDelete[] =
 #else
     nullptr,
 #endif
-    nullptr,   // FX_RESERVED6
+#ifndef eCFG_NO_TF_FX_CONVOLUTION
+    eTfEffectConvolutionDelete,
+#else
+    nullptr,
+#endif
     nullptr,   // FX_RESERVED7
     nullptr,   // FX_RESERVED8
 };
@@ -366,9 +441,99 @@ static eTfEffectProcessProc s_effectProcess[] =
 #else
     nullptr,
 #endif
-    nullptr,   // FX_RESERVED6
+#ifndef eCFG_NO_TF_FX_CONVOLUTION
+    eTfEffectConvolutionProcess,
+#else
+    nullptr,
+#endif
     nullptr,   // FX_RESERVED7
     nullptr,   // FX_RESERVED8
 };
 
+static eTfEffectTailProc s_effectTail[] =
+{
+    nullptr,
+#ifndef eCFG_NO_TF_FX_DISTORTION
+    eTfEffectDistortionTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_DELAY
+    eTfEffectDelayTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_CHORUS
+    eTfEffectChorusTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_FLANGER
+    eTfEffectFlangerTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_REVERB
+    eTfEffectReverbTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_FORMANT
+    eTfEffectFormantTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_EQ
+    eTfEffectEqTail,
+#else
+    nullptr,
+#endif
+#ifndef eCFG_NO_TF_FX_CONVOLUTION
+    eTfEffectConvolutionTail,
+#else
+    nullptr,
+#endif
+    nullptr,   // FX_RESERVED7
+    nullptr,   // FX_RESERVED8
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+//  EFFECT POOL
+// ---------------------------------------------------------------------------------------------------------------------------
+
+// effect instances are built and destroyed by a service thread, so the
+// audio thread never allocates or frees memory when an effect slot changes.
+// one spare instance per effect type is kept ready, requests for missing
+// instances and retired instances are handed over through lock-free queues.
+
+const eU32 TF_EFFECTPOOL_QUEUESIZE = 64;
+
+struct eTfEffectPoolItem
+{
+    eU32                fxIndex;
+    eU32                sampleRate;
+    eTfEffect *         fx;
+};
+
+struct eTfEffectPool
+{
+    // owned by the audio thread
+    eU32                sampleRate;
+    eTfEffect *         spare[FX_COUNT];
+    eBool               requested[FX_COUNT];
+
+    // audio thread -> service thread
+    eLockFreeQueue<eTfEffectPoolItem, TF_EFFECTPOOL_QUEUESIZE>  requests;
+    eLockFreeQueue<eTfEffectPoolItem, TF_EFFECTPOOL_QUEUESIZE>  retired;
+
+    // service thread -> audio thread
+    eLockFreeQueue<eTfEffectPoolItem, TF_EFFECTPOOL_QUEUESIZE>  ready;
+};
+
+void            eTfEffectPoolInit(eTfEffectPool &pool, eU32 sampleRate);
+void            eTfEffectPoolFree(eTfEffectPool &pool);
+void            eTfEffectPoolService(eTfEffectPool &pool);
+eTfEffect *     eTfEffectPoolAcquire(eTfEffectPool &pool, eU32 fxIndex, eU32 sampleRate);
+void            eTfEffectPoolRelease(eTfEffectPool &pool, eU32 fxIndex, eTfEffect *fx);
+
 #endif
@@ -0,0 +1,96 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#include "runtime/system.hpp"
+#include "tfeffectchain.hpp"
+
+EffectChain::EffectChain (eTfWorkerPool &p, eTfSynth &s, eTfInstrument &i) :
+    pool (p), synth (s), instr (i), jobIndex (0)
+{
+    for (eU32 j=0; j<2; j++)
+    {
+        for (eU32 ch=0; ch<2; ch++)
+        {
+            buffers[j][ch] = (eF32 *)eAllocAlignedAndZero(TF_BUFFERSIZE*sizeof(eF32), 16);
+        }
+    }
+}
+
+EffectChain::~EffectChain()
+{
+    pool.wait (batch);
+
+    for (eU32 j=0; j<2; j++)
+    {
+        for (eU32 ch=0; ch<2; ch++)
+        {
+            eFreeAligned(buffers[j][ch]);
+        }
+    }
+}
+
+void EffectChain::process (eF32 **block, double deadline)
+{
+    // wait for block N-1, it ran while we rendered voices of block N
+    pool.wait (batch);
+
+    eF32 **done = buffers[jobIndex];
+    eF32 **next = buffers[jobIndex ^ 1];
+
+    for (eU32 ch=0; ch<2; ch++)
+    {
+        eMemCopy(next[ch], block[ch], TF_BUFFERSIZE*sizeof(eF32));
+        eMemCopy(block[ch], done[ch], TF_BUFFERSIZE*sizeof(eF32));
+    }
+
+    // the job reads its own copy, the audio thread may change
+    // parameters and sample rate while it runs
+    eTfInstrumentGetEffectInput (synth, instr, input);
+
+    jobIndex ^= 1;
+    pool.submit (batch, &EffectChain::run, this, 1, deadline);
+}
+
+void EffectChain::finish()
+{
+    pool.wait (batch);
+
+    for (eU32 j=0; j<2; j++)
+    {
+        for (eU32 ch=0; ch<2; ch++)
+        {
+            eMemSet(buffers[j][ch], 0, TF_BUFFERSIZE*sizeof(eF32));
+        }
+    }
+}
+
+void EffectChain::run (void *context, eU32)
+{
+    EffectChain &chain = *static_cast<EffectChain *> (context);
+    eTfInstrumentProcessEffects (chain.synth, chain.instr, chain.input, chain.buffers[chain.jobIndex], TF_BUFFERSIZE);
+}
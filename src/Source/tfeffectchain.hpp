@@ -0,0 +1,73 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_EFFECTCHAIN_HPP
+#define TF_EFFECTCHAIN_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "runtime/system.hpp"
+#include "synth/tf4.hpp"
+#include "tfworkerpool.hpp"
+
+
+/**
+ Runs the effect chain one block behind voice rendering, so voices of
+ block N+1 and effects of block N use two cores. The audio thread hands
+ over each voice block and takes back the previous block with effects
+ applied. The effects run as a job on the shared worker pool, if no
+ worker got to it in time the audio thread runs it itself. Adds
+ TF_BUFFERSIZE samples of latency.
+ */
+
+class EffectChain
+{
+public:
+     EffectChain (eTfWorkerPool &p, eTfSynth &s, eTfInstrument &i);
+    ~EffectChain();
+
+    // Called by the audio thread with a block of rendered voices.
+    // Returns the previous block with effects applied, in place.
+    // The block handed over is due by deadline.
+    void process (eF32 **block, double deadline);
+
+    // Called by the audio thread before it leaves pipelined mode.
+    // The block still in flight is dropped and the buffers are
+    // cleared, so re-entering the mode starts with silence.
+    void finish();
+
+private:
+    static void run (void *context, eU32);
+
+    eTfWorkerPool &         pool;
+    eTfWorkerPool::Batch    batch;
+    eTfSynth &              synth;
+    eTfInstrument &         instr;
+    eTfEffectInput          input;
+    eF32 *                  buffers[2][2];
+    eU32                    jobIndex;
+};
+
+#endif
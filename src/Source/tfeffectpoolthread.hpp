@@ -0,0 +1,55 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_EFFECTPOOLTHREAD_HPP
+#define TF_EFFECTPOOLTHREAD_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "runtime/system.hpp"
+#include "synth/tf4.hpp"
+
+
+/**
+ Builds and destroys effect instances requested by the audio thread,
+ so switching effect slots never allocates in the audio callback.
+ Serves one pool per instrument.
+ */
+
+class EffectPoolThread : public Thread
+{
+public:
+    EffectPoolThread (eTfEffectPool &p);
+
+    void addPool (eTfEffectPool &p);
+
+    void run() override;
+
+private:
+    CriticalSection         lock;
+    Array<eTfEffectPool *>  pools;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#include "runtime/system.hpp"
+#include "tfimpulseresponseloader.hpp"
+
+ImpulseResponseLoader::ImpulseResponseLoader (eTfSynth &s, eTfConvolutionIrExchange &e) :
+    Thread ("Sprike IR Loader"), synth (s), exchange (e), sampleRate (0), pending (false)
+{
+}
+
+void ImpulseResponseLoader::load (const File &f)
+{
+    {
+        ScopedLock sl (lock);
+        file = f;
+        pending = true;
+    }
+    notify();
+}
+
+void ImpulseResponseLoader::setSampleRate (eU32 rate)
+{
+    {
+        ScopedLock sl (lock);
+        if (rate == sampleRate)
+            return;
+
+        sampleRate = rate;
+        pending = pending || file != File();
+    }
+    notify();
+}
+
+File ImpulseResponseLoader::getFile() const
+{
+    ScopedLock sl (lock);
+    return file;
+}
+
+void ImpulseResponseLoader::run()
+{
+    while (!threadShouldExit())
+    {
+        eTfConvolutionIrExchangeCollect (exchange);
+
+        File f;
+        eU32 rate;
+        bool job;
+        {
+            ScopedLock sl (lock);
+            f = file;
+            rate = sampleRate;
+            job = pending;
+            pending = false;
+        }
+
+        if (job && rate > 0 && f.existsAsFile())
+            loadFile (f, rate);
+
+        wait (100);
+    }
+}
+
+void ImpulseResponseLoader::loadFile (const File &f, eU32 rate)
+{
+    AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    ScopedPointer<AudioFormatReader> reader = formats.createReaderFor (f);
+    if (reader == nullptr || reader->sampleRate <= 0)
+        return;
+
+    const double ratio = reader->sampleRate / rate;
+    const int sourceLength = (int) jmin (reader->lengthInSamples, (int64) (TF_FX_CONV_MAXSECONDS * reader->sampleRate));
+    const int length = (int) (sourceLength / ratio);
+
+    // a few zeros past the end for the interpolator to look ahead
+    AudioSampleBuffer source (2, sourceLength + 8);
+    source.clear();
+    reader->read (&source, 0, sourceLength, 0, true, true);
+    if (reader->numChannels == 1)
+        source.copyFrom (1, 0, source, 0, 0, sourceLength);
+
+    AudioSampleBuffer resampled (2, jmax (length, 1));
+    resampled.clear();
+    for (int ch = 0; ch < 2; ch++)
+    {
+        LagrangeInterpolator interpolator;
+        interpolator.process (ratio, source.getReadPointer (ch), resampled.getWritePointer (ch), length);
+    }
+
+    eTfConvolutionIr *ir = eTfConvolutionIrCreate (synth, resampled.getReadPointer (0), resampled.getReadPointer (1), length, rate);
+    if (!eTfConvolutionIrExchangePublish (exchange, ir))
+        eTfConvolutionIrFree (ir);
+}
@@ -0,0 +1,66 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_IMPULSERESPONSELOADER_HPP
+#define TF_IMPULSERESPONSELOADER_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "runtime/system.hpp"
+#include "synth/tf4.hpp"
+
+
+/**
+ Decodes impulse responses for the convolution effect, resamples them to
+ the synth's rate and transforms them, then hands them to the audio thread.
+ Also frees the responses the audio thread has retired.
+ */
+
+class ImpulseResponseLoader : public Thread
+{
+public:
+    ImpulseResponseLoader (eTfSynth &s, eTfConvolutionIrExchange &e);
+
+    void load (const File &f);
+
+    // the transformed response is only valid for one rate
+    void setSampleRate (eU32 rate);
+
+    File getFile() const;
+
+    void run() override;
+
+private:
+    void loadFile (const File &f, eU32 rate);
+
+    eTfSynth &                  synth;
+    eTfConvolutionIrExchange &  exchange;
+    CriticalSection             lock;
+    File                        file;
+    eU32                        sampleRate;
+    bool                        pending;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_PARAMETERSTORE_HPP
+#define TF_PARAMETERSTORE_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "synth/tf4.hpp"
+
+
+/**
+ Parameter values shared by the host, the editor and the audio thread.
+ Any thread may store values at any time. Each store sets a bit in a
+ changed-set, which the audio thread drains at the start of a block to
+ hand the new values to the instrument, where continuous ones ramp over
+ the block. Nobody ever takes a lock, and several stores to one
+ parameter between two blocks collapse into one.
+
+ A second changed-set does the same for the editor, which drains it
+ once per UI frame and only touches the controls that changed.
+ */
+
+class eTfParameterStore
+{
+public:
+    static const eU32 CHANGED_WORDS = (TF_PARAM_COUNT + 31) / 32;
+
+    // Parameters collected from the editor changed-set
+    struct Changes
+    {
+        Changes() { clear(); }
+
+        void clear()                    { eMemSet(bits, 0, sizeof(bits)); }
+        void setAll()                   { eMemSet(bits, 0xff, sizeof(bits)); }
+        bool contains (eU32 index) const { return (bits[index / 32] & (1u << (index % 32))) != 0; }
+
+        bool any() const
+        {
+            for (eU32 word=0; word<CHANGED_WORDS; word++)
+                if (bits[word] != 0)
+                    return true;
+            return false;
+        }
+
+        eU32 bits[CHANGED_WORDS];
+    };
+
+    eTfParameterStore()
+    {
+        for (eU32 word=0; word<CHANGED_WORDS; word++)
+        {
+            changed[word].store(0);
+            uiChanged[word].store(0);
+        }
+
+        for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+            values[i].set(TF_DEFAULTPROG[i]);
+
+        markAllChanged();
+    }
+
+    eF32 get (eU32 index) const
+    {
+        eASSERT(index < TF_PARAM_COUNT);
+        return values[index].get();
+    }
+
+    void set (eU32 index, eF32 value)
+    {
+        eASSERT(index < TF_PARAM_COUNT);
+        values[index].set(value);
+        changed[index / 32].fetch_or(1u << (index % 32), std::memory_order_release);
+        uiChanged[index / 32].fetch_or(1u << (index % 32), std::memory_order_release);
+    }
+
+    void markAllChanged()
+    {
+        for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        {
+            changed[i / 32].fetch_or(1u << (i % 32), std::memory_order_release);
+            uiChanged[i / 32].fetch_or(1u << (i % 32), std::memory_order_release);
+        }
+    }
+
+    // Message thread only. Adds the parameters changed since
+    // the last call to changes, returns true if there were any.
+    bool collectUiChanges (Changes &changes)
+    {
+        bool any = false;
+
+        for (eU32 word=0; word<CHANGED_WORDS; word++)
+        {
+            // cheap read first, so an idle editor never writes the shared line
+            if (uiChanged[word].load(std::memory_order_relaxed) == 0)
+                continue;
+
+            changes.bits[word] |= uiChanged[word].exchange(0, std::memory_order_acquire);
+            any = true;
+        }
+
+        return any;
+    }
+
+    // Audio thread only. Sets the values changed since the last
+    // call on the instrument, returns true if there were any.
+    bool apply (eTfInstrument &instr)
+    {
+        bool any = false;
+
+        for (eU32 word=0; word<CHANGED_WORDS; word++)
+        {
+            const eU32 bits = changed[word].exchange(0, std::memory_order_acquire);
+            if (bits == 0)
+                continue;
+
+            for (eU32 bit=0; bit<32; bit++)
+            {
+                if (bits & (1u << bit))
+                    eTfInstrumentSetParam(instr, word * 32 + bit, values[word * 32 + bit].get());
+            }
+
+            any = true;
+        }
+
+        return any;
+    }
+
+private:
+    Atomic<float>           values[TF_PARAM_COUNT];
+    std::atomic<eU32>       changed[CHANGED_WORDS];
+    std::atomic<eU32>       uiChanged[CHANGED_WORDS];
+
+    JUCE_DECLARE_NON_COPYABLE (eTfParameterStore)
+};
+
+#endif
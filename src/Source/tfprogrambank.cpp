@@ -0,0 +1,165 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#include "runtime/system.hpp"
+#include "tfprogrambank.hpp"
+
+eU32 eTfProgramBank::stampOf (const File *files, eU32 count)
+{
+    MemoryOutputStream stream;
+
+    for (eU32 i=0; i<count; i++)
+    {
+        stream.writeInt((int)i);
+        if (files[i] == File())
+            continue;
+
+        stream.writeString(files[i].getFullPathName());
+        stream.writeInt64(files[i].getSize());
+        stream.writeInt64(files[i].getLastModificationTime().toMilliseconds());
+    }
+
+    return eCrc32(stream.getData(), (eU32)stream.getDataSize());
+}
+
+bool eTfProgramBank::read (const File &file, eU32 stamp, eTfSynthProgram *programs)
+{
+    MemoryMappedFile map (file, MemoryMappedFile::readOnly);
+    const eU8 *data = (const eU8 *)map.getData();
+    const size_t size = map.getSize();
+
+    if (data == nullptr || size < sizeof(Header))
+        return false;
+
+    const Header &header = *(const Header *)data;
+
+    if (memcmp(header.magic, "SPBK", 4) != 0 ||
+        header.version != VERSION ||
+        header.stamp != stamp ||
+        header.programCount != PROGRAMS ||
+        header.nameSize != NAMESIZE ||
+        header.recordSize != sizeof(eU32) + header.paramCount * sizeof(eF32) ||
+        header.crc != eCrc32(&header, offsetof(Header, crc)))
+        return false;
+
+    if (header.paramIdsOffset + header.paramCount * sizeof(eU32) > size ||
+        header.namesOffset + PROGRAMS * NAMESIZE > size ||
+        header.recordsOffset + PROGRAMS * header.recordSize > size)
+        return false;
+
+    // map the stored columns to the current parameters, columns
+    // of unknown parameters are skipped and missing ones keep
+    // their default values
+    const eU32 *ids = (const eU32 *)(data + header.paramIdsOffset);
+    eS32 columns[TF_PARAM_COUNT];
+
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        columns[i] = -1;
+
+    for (eU32 c=0; c<header.paramCount; c++)
+    {
+        const int index = eTfSynthProgram::findParamById(ids[c]);
+        if (index >= 0)
+            columns[index] = c;
+    }
+
+    // verify all records before touching any program
+    for (eU32 p=0; p<PROGRAMS; p++)
+    {
+        const eU8 *name = data + header.namesOffset + p * NAMESIZE;
+        const eU8 *record = data + header.recordsOffset + p * header.recordSize;
+
+        eU32 crc = eCrc32(name, NAMESIZE);
+        crc = eCrc32(record + sizeof(eU32), header.recordSize - sizeof(eU32), crc);
+
+        if (crc != *(const eU32 *)record)
+            return false;
+    }
+
+    for (eU32 p=0; p<PROGRAMS; p++)
+    {
+        const char *name = (const char *)(data + header.namesOffset + p * NAMESIZE);
+        const eF32 *values = (const eF32 *)(data + header.recordsOffset + p * header.recordSize + sizeof(eU32));
+
+        programs[p].setName(String::fromUTF8(name, (int)strnlen(name, NAMESIZE)));
+
+        for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        {
+            if (columns[i] >= 0)
+                programs[p].setParam(i, values[columns[i]]);
+        }
+    }
+
+    return true;
+}
+
+bool eTfProgramBank::write (const File &file, eU32 stamp, const eTfSynthProgram *programs)
+{
+    Header header;
+    eMemSet(&header, 0, sizeof(header));
+    eMemCopy(header.magic, "SPBK", 4);
+    header.version = VERSION;
+    header.stamp = stamp;
+    header.programCount = PROGRAMS;
+    header.paramCount = TF_PARAM_COUNT;
+    header.nameSize = NAMESIZE;
+    header.paramIdsOffset = sizeof(Header);
+    header.namesOffset = header.paramIdsOffset + TF_PARAM_COUNT * sizeof(eU32);
+    header.recordsOffset = header.namesOffset + PROGRAMS * NAMESIZE;
+    header.recordSize = sizeof(eU32) + TF_PARAM_COUNT * sizeof(eF32);
+    header.crc = eCrc32(&header, offsetof(Header, crc));
+
+    MemoryBlock block (header.recordsOffset + PROGRAMS * header.recordSize, true);
+    eU8 *data = (eU8 *)block.getData();
+    eMemCopy(data, &header, sizeof(header));
+
+    eU32 *ids = (eU32 *)(data + header.paramIdsOffset);
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        ids[i] = eTfSynthProgram::paramId(i);
+
+    for (eU32 p=0; p<PROGRAMS; p++)
+    {
+        eU8 *name = data + header.namesOffset + p * NAMESIZE;
+        eU8 *record = data + header.recordsOffset + p * header.recordSize;
+
+        programs[p].getName().copyToUTF8((CharPointer_UTF8::CharType *)name, NAMESIZE);
+        eMemCopy(record + sizeof(eU32), programs[p].getParams(), TF_PARAM_COUNT * sizeof(eF32));
+
+        eU32 crc = eCrc32(name, NAMESIZE);
+        crc = eCrc32(record + sizeof(eU32), header.recordSize - sizeof(eU32), crc);
+        *(eU32 *)record = crc;
+    }
+
+    // replaced in one step, readers never see a partial file
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temp (file);
+    if (!temp.getFile().replaceWithData(block.getData(), block.getSize()))
+        return false;
+
+    return temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,78 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_PROGRAMBANK_HPP
+#define TF_PROGRAMBANK_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "tfsynthprogram.hpp"
+
+
+/**
+ Binary cache of one bank of programs, built from the text preset files.
+ A fixed-layout header is followed by the stable ID of every parameter
+ column, a table of program names and one record of dense values per
+ program, each with its own CRC. The file is read through a read-only
+ memory map. Its stamp identifies the text files it was built from, so
+ it is rebuilt as soon as any of them changes. The text files remain
+ the format for import, export and saving.
+ */
+
+class eTfProgramBank
+{
+public:
+    static const eU32 PROGRAMS = 128;
+
+    // Fills programs[0..PROGRAMS) if the file is intact and was built
+    // from sources with this stamp. Leaves them untouched otherwise.
+    static bool read(const File &file, eU32 stamp, eTfSynthProgram *programs);
+
+    static bool write(const File &file, eU32 stamp, const eTfSynthProgram *programs);
+
+    // identifies the current state of the given source files
+    static eU32 stampOf(const File *files, eU32 count);
+
+private:
+    static const eU32 VERSION = 1;
+    static const eU32 NAMESIZE = 64;
+
+    struct Header
+    {
+        char        magic[4];
+        eU32        version;
+        eU32        stamp;
+        eU32        programCount;
+        eU32        paramCount;
+        eU32        nameSize;
+        eU32        paramIdsOffset;     // paramCount x eU32
+        eU32        namesOffset;        // programCount x nameSize bytes of UTF-8
+        eU32        recordsOffset;      // programCount x recordSize
+        eU32        recordSize;         // eU32 crc, then paramCount x eF32
+        eU32        crc;                // over all fields above
+    };
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#include "runtime/system.hpp"
+#include "tfprogramloader.hpp"
+
+ProgramLoader::ProgramLoader (const File &user, const File &factory) :
+    Thread ("Sprike Program Loader"), userDirectory (user), factoryDirectory (factory), loaded (0)
+{
+    for (int i=0; i<TF_PLUG_NUM_PROGRAMS; i++)
+        legacy[i] = false;
+}
+
+ProgramLoader::~ProgramLoader()
+{
+    stopThread (5000);
+}
+
+void ProgramLoader::run()
+{
+    // lowest precedence first, later folders override
+    for (int bank=0; bank<TF_PLUG_NUM_PROGRAMS/128; bank++)
+    {
+        const String folder = String("bank") + String(bank);
+        findFiles (factoryDirectory.getChildFile (folder), bank * 128, 128, false);
+        findFiles (userDirectory.getChildFile (folder), bank * 128, 128, false);
+    }
+    findFiles (userDirectory.getChildFile ("tf4programs"), 0, TF_PLUG_NUM_PROGRAMS, true);
+
+    for (int bank=0; bank<TF_PLUG_NUM_PROGRAMS/128; bank++)
+    {
+        if (threadShouldExit())
+            return;
+
+        loadBank (bank);
+        sendChangeMessage();
+    }
+}
+
+void ProgramLoader::loadBank (int bank)
+{
+    const int first = bank * eTfProgramBank::PROGRAMS;
+    const File cache = userDirectory.getChildFile ("cache").getChildFile (String("bank") + String(bank) + ".bin");
+    const eU32 stamp = eTfProgramBank::stampOf (&files[first], eTfProgramBank::PROGRAMS);
+
+    // old Tunefish4 files are migrated once, no need to cache them
+    bool hasLegacy = false;
+    for (eU32 i=0; i<eTfProgramBank::PROGRAMS; i++)
+    {
+        programs[first + i].loadDefault (first + i);
+        hasLegacy = hasLegacy || legacy[first + i];
+    }
+
+    if (!hasLegacy && eTfProgramBank::read (cache, stamp, &programs[first]))
+    {
+        loaded.set (first + eTfProgramBank::PROGRAMS);
+        return;
+    }
+
+    for (eU32 i=0; i<eTfProgramBank::PROGRAMS; i++)
+    {
+        const int index = first + i;
+        if (files[index] != File() && !programs[index].loadFromFile (files[index]))
+        {
+            programs[index].loadDefault (index);
+            files[index] = File();
+        }
+
+        loaded.set (index + 1);
+    }
+
+    if (!hasLegacy)
+        eTfProgramBank::write (cache, stamp, &programs[first]);
+}
+
+void ProgramLoader::findFiles (const File &folder, int first, int count, bool old)
+{
+    Array<File> found;
+    folder.findChildFiles (found, File::findFiles, false, "program*.txt");
+
+    for (const File &file : found)
+    {
+        const String number = file.getFileNameWithoutExtension().substring (7);
+        if (number.isEmpty() || !number.containsOnly ("0123456789"))
+            continue;
+
+        const int prog = number.getIntValue();
+        if (prog >= count)
+            continue;
+
+        files[first + prog] = file;
+        legacy[first + prog] = old;
+    }
+}
+
+BankImporter::BankImporter (const File &f, eU32 firstProgram) :
+    Thread ("Sprike Bank Import"), folder (f), first (firstProgram)
+{
+    for (eU32 i=0; i<eTfProgramBank::PROGRAMS; i++)
+        found[i] = false;
+}
+
+BankImporter::~BankImporter()
+{
+    stopThread (5000);
+}
+
+String BankImporter::fileName (eU32 prog)
+{
+    return String("program") + String(prog).paddedLeft('0',3) + String(".txt");
+}
+
+void BankImporter::run()
+{
+    for (eU32 prog=0; prog<eTfProgramBank::PROGRAMS; prog++)
+    {
+        if (threadShouldExit())
+            return;
+
+        const File source = folder.getChildFile (fileName (prog));
+        programs[prog].loadDefault (first + prog);
+        found[prog] = source.existsAsFile() && programs[prog].loadFromFile (source);
+    }
+
+    sendChangeMessage();
+}
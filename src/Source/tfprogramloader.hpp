@@ -0,0 +1,135 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_PROGRAMLOADER_HPP
+#define TF_PROGRAMLOADER_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "runtime/system.hpp"
+#include "tfsynthprogram.hpp"
+#include "tfprogrambank.hpp"
+
+const eU32 TF_PLUG_NUM_PROGRAMS = 1024;
+
+
+/**
+ Loads the program library in the background. Every bank folder is
+ listed once instead of probing each program file. A bank is read from
+ its binary cache when that is current, otherwise it is parsed from
+ the text files and the cache rebuilt. Loaded programs are picked up
+ by the processor on the message thread as they finish.
+ */
+
+class ProgramLoader : public Thread, public ChangeBroadcaster
+{
+public:
+     ProgramLoader (const File &user, const File &factory);
+    ~ProgramLoader();
+
+    // programs below this index are loaded
+    int getNumLoaded() const
+    {
+        return loaded.get();
+    }
+
+    const eTfSynthProgram & getProgram (int index) const
+    {
+        jassert (index < getNumLoaded());
+        return programs[index];
+    }
+
+    // the file a loaded program came from, if any
+    const File & getFile (int index) const
+    {
+        jassert (index < getNumLoaded());
+        return files[index];
+    }
+
+    // true if a loaded program came from the old Tunefish4 folder
+    bool isLegacy (int index) const
+    {
+        jassert (index < getNumLoaded());
+        return legacy[index];
+    }
+
+    void run() override;
+
+private:
+    void loadBank (int bank);
+
+    // files are named program<N>.txt, old ones without leading zeros
+    void findFiles (const File &folder, int first, int count, bool old);
+
+    File                    userDirectory;
+    File                    factoryDirectory;
+    File                    files[TF_PLUG_NUM_PROGRAMS];
+    bool                    legacy[TF_PLUG_NUM_PROGRAMS];
+    eTfSynthProgram         programs[TF_PLUG_NUM_PROGRAMS];
+    Atomic<int>             loaded;
+};
+
+
+/**
+ Reads the program files of a bank folder in the background, for an
+ import into the bank starting at first. The processor takes them over
+ on the message thread once all have been read.
+ */
+
+class BankImporter : public Thread, public ChangeBroadcaster
+{
+public:
+     BankImporter (const File &f, eU32 firstProgram);
+    ~BankImporter();
+
+    eU32 getFirst() const
+    {
+        return first;
+    }
+
+    // programs without a readable file in the folder are not found.
+    // valid once the change message came in.
+    bool isFound (eU32 prog) const
+    {
+        return found[prog];
+    }
+
+    const eTfSynthProgram & getProgram (eU32 prog) const
+    {
+        return programs[prog];
+    }
+
+    static String fileName (eU32 prog);
+
+    void run() override;
+
+private:
+    File                    folder;
+    eU32                    first;
+    bool                    found[eTfProgramBank::PROGRAMS];
+    eTfSynthProgram         programs[eTfProgramBank::PROGRAMS];
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#include "runtime/system.hpp"
+#include "tfprogramwriter.hpp"
+
+ProgramWriter::ProgramWriter() : Thread ("Sprike Program Writer")
+{
+}
+
+ProgramWriter::~ProgramWriter()
+{
+    stopThread (10000);
+}
+
+void ProgramWriter::write (const File &file, const String &text, const File &obsolete)
+{
+    {
+        ScopedLock sl (lock);
+        queue (file, text, obsolete);
+    }
+    notify();
+}
+
+void ProgramWriter::write (const Array<File> &files, const StringArray &texts)
+{
+    jassert (files.size() == texts.size());
+    {
+        ScopedLock sl (lock);
+        for (int i=0; i<files.size(); i++)
+            queue (files[i], texts[i], File());
+    }
+    notify();
+}
+
+void ProgramWriter::run()
+{
+    while (true)
+    {
+        Array<Job> jobs;
+        {
+            ScopedLock sl (lock);
+            jobs.swapWith (pending);
+        }
+
+        for (const Job &job : jobs)
+        {
+            if (writeFile (job.file, job.text))
+                job.obsolete.deleteFile();
+            else
+                reportFailure (job.file);
+        }
+
+        if (jobs.isEmpty())
+        {
+            if (threadShouldExit())
+                return;
+
+            wait (1000);
+        }
+    }
+}
+
+void ProgramWriter::queue (const File &file, const String &text, const File &obsolete)
+{
+    for (Job &job : pending)
+    {
+        if (job.file == file)
+        {
+            job.text = text;
+            job.obsolete = job.obsolete == File() ? obsolete : job.obsolete;
+            return;
+        }
+    }
+
+    pending.add ({ file, text, obsolete });
+}
+
+bool ProgramWriter::writeFile (const File &file, const String &text)
+{
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temp (file);
+    {
+        FileOutputStream stream (temp.getFile());
+        if (stream.failedToOpen())
+            return false;
+
+        stream.writeText (text, false, false, nullptr);
+        // flush() syncs the file to disk
+        stream.flush();
+        if (stream.getStatus().failed())
+            return false;
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void ProgramWriter::reportFailure (const File &file)
+{
+    const String path = file.getFullPathName();
+    MessageManager::callAsync ([path]
+    {
+        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Error", "Failed writing " + path);
+    });
+}
@@ -0,0 +1,72 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_PROGRAMWRITER_HPP
+#define TF_PROGRAMWRITER_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+/**
+ Writes preset files in the background. Each file is written to a
+ temporary file, synced to disk and renamed over the target, so a
+ crash never leaves a truncated preset. Pending writes of the same
+ file coalesce. Anything still queued is written before the thread
+ ends.
+ */
+
+class ProgramWriter : public Thread
+{
+public:
+     ProgramWriter();
+    ~ProgramWriter();
+
+    // obsolete, if given, is deleted once the file is written
+    void write (const File &file, const String &text, const File &obsolete = File());
+
+    // queues a whole bank as one job
+    void write (const Array<File> &files, const StringArray &texts);
+
+    void run() override;
+
+private:
+    struct Job
+    {
+        File    file;
+        String  text;
+        File    obsolete;
+    };
+
+    void queue (const File &file, const String &text, const File &obsolete);
+
+    static bool writeFile (const File &file, const String &text);
+    static void reportFailure (const File &file);
+
+    CriticalSection         lock;
+    Array<Job>              pending;
+};
+
+#endif
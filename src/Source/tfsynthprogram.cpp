@@ -29,67 +29,218 @@
 #include "runtime/system.hpp"
 #include "tfsynthprogram.hpp"
 
+namespace
+{
+    // TF_NAMES sorted by name for binary search
+    struct ParamNameIndex
+    {
+        ParamNameIndex()
+        {
+            for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+                sorted[i] = i;
+
+            std::sort(sorted, sorted + TF_PARAM_COUNT, [] (eU32 a, eU32 b)
+            {
+                return strcmp(TF_NAMES[a], TF_NAMES[b]) < 0;
+            });
+        }
+
+        int find (const char *name) const
+        {
+            int lo = 0;
+            int hi = TF_PARAM_COUNT - 1;
+
+            while (lo <= hi)
+            {
+                const int mid = (lo + hi) / 2;
+                const int cmp = strcmp(name, TF_NAMES[sorted[mid]]);
+
+                if (cmp == 0)
+                    return sorted[mid];
+                else if (cmp < 0)
+                    hi = mid - 1;
+                else
+                    lo = mid + 1;
+            }
+
+            return -1;
+        }
+
+        eU32 sorted[TF_PARAM_COUNT];
+    };
+
+    // parameter IDs sorted for binary search
+    struct ParamIdIndex
+    {
+        ParamIdIndex()
+        {
+            for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+                sorted[i] = i;
+
+            std::sort(sorted, sorted + TF_PARAM_COUNT, [] (eU32 a, eU32 b)
+            {
+                return eTfSynthProgram::paramId(a) < eTfSynthProgram::paramId(b);
+            });
+        }
+
+        int find (eU32 id) const
+        {
+            int lo = 0;
+            int hi = TF_PARAM_COUNT - 1;
+
+            while (lo <= hi)
+            {
+                const int mid = (lo + hi) / 2;
+                const eU32 midId = eTfSynthProgram::paramId(sorted[mid]);
+
+                if (id == midId)
+                    return sorted[mid];
+                else if (id < midId)
+                    hi = mid - 1;
+                else
+                    lo = mid + 1;
+            }
+
+            return -1;
+        }
+
+        eU32 sorted[TF_PARAM_COUNT];
+    };
+}
+
 eTfSynthProgram::eTfSynthProgram()
 {
+    clear();
 }
 
 
 eTfSynthProgram::eTfSynthProgram(const eTfSynthProgram& copy) noexcept
     : name (copy.getName())
 {
-    for (int i=0; i < TF_PARAM_COUNT; i++)
-        if (copy.hasParam(i))
-            params.set(i, copy.getParam(i));
+    eMemCopy(params, copy.params, sizeof(params));
+    eMemCopy(present, copy.present, sizeof(present));
 }
 
 eTfSynthProgram& eTfSynthProgram::operator= (const eTfSynthProgram& copy)
 {
     name = copy.getName();
-    params.clear();
-    for (int i=0; i < TF_PARAM_COUNT; i++)
-        if (copy.hasParam(i))
-            params.set(i, copy.getParam(i));
+    eMemCopy(params, copy.params, sizeof(params));
+    eMemCopy(present, copy.present, sizeof(present));
     return *this;
 }
 
+void eTfSynthProgram::clear()
+{
+    eMemSet(params, 0, sizeof(params));
+    eMemSet(present, 0, sizeof(present));
+}
+
 void eTfSynthProgram::loadDefault (int i)
 {
     name = String("INIT " + String(i));
-    params.clear();
-    for (int i=0; i < TF_PARAM_COUNT; i++)
-        params.set(i, TF_DEFAULTPROG[i]);
+    setParams(TF_DEFAULTPROG);
 }
 
+bool eTfSynthProgram::loadFromFile (const File &file)
+{
+    ScopedPointer<FileInputStream> stream = file.createInputStream();
+    if (stream == nullptr)
+        return false;
+
+    setName(stream->readNextLine());
+
+    while(true)
+    {
+        String line = stream->readNextLine();
+        if (line.length() == 0)
+            break;
+
+        const int separator = line.indexOfChar(';');
+        if (separator < 0 || line.indexOfChar(separator + 1, ';') >= 0)
+            continue;
 
-void eTfSynthProgram::applyToSynth (eTfInstrument* inst)
+        const int index = findParam(line.substring(0, separator));
+        if (index >= 0)
+            setParam(index, line.substring(separator + 1).getFloatValue());
+    }
+
+    return true;
+}
+
+// the preset file format, read back by loadFromFile
+String eTfSynthProgram::toText() const
+{
+    String text;
+    text.preallocateBytes(TF_PARAM_COUNT * 32);
+    text << name << "\r\n";
+
+    for (eU32 i=0; i<TF_PARAM_COUNT; i++)
+        text << TF_NAMES[i] << ";" << String(params[i]) << "\r\n";
+
+    return text;
+}
+
+int eTfSynthProgram::findParam (const String &name)
+{
+    static const ParamNameIndex index;
+    return index.find(name.toRawUTF8());
+}
+
+eU32 eTfSynthProgram::paramId (eU32 index)
+{
+    return eHashStr(TF_NAMES[index]);
+}
+
+int eTfSynthProgram::findParamById (eU32 id)
+{
+    static const ParamIdIndex index;
+    return index.find(id);
+}
+
+
+void eTfSynthProgram::applyToSynth (eTfParameterStore &store) const
 {
     for (int i=0; i < TF_PARAM_COUNT; i++)
-        inst->params[i] = getParam(i);
+        store.set(i, params[i]);
 }
 
-void eTfSynthProgram::loadFromSynth (eTfInstrument* inst)
+void eTfSynthProgram::loadFromSynth (const eTfParameterStore &store)
 {
     for (int i=0; i < TF_PARAM_COUNT; i++)
-        params.set(i, inst->params[i]);
+        params[i] = store.get(i);
+
+    eMemSet(present, 0xff, sizeof(present));
 }
 
 
 void eTfSynthProgram::setParam (eU32 index, eF32 value)
 {
-    params.set(index,value);
+    eASSERT(index < TF_PARAM_COUNT);
+    params[index] = value;
+    present[index / 32] |= 1u << (index % 32);
 }
 
 eF32 eTfSynthProgram::getParam (eU32 index) const
 {
-    if (params.contains(index))
-        return params[index];
-    else
-        return 0.0f;
+    eASSERT(index < TF_PARAM_COUNT);
+    return params[index];
 }
 
 bool eTfSynthProgram::hasParam (eU32 index) const
 {
-    return params.contains(index);
+    eASSERT(index < TF_PARAM_COUNT);
+    return (present[index / 32] & (1u << (index % 32))) != 0;
+}
+
+const eF32 * eTfSynthProgram::getParams() const
+{
+    return params;
+}
+
+void eTfSynthProgram::setParams (const eF32 *values)
+{
+    eMemCopy(params, values, sizeof(params));
+    eMemSet(present, 0xff, sizeof(present));
 }
 
 String eTfSynthProgram::getName() const
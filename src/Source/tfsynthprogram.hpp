@@ -29,14 +29,19 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "synth/tf4.hpp"
+#include "tfparameterstore.hpp"
 
 
+/**
+ A named set of parameter values. Values live in a dense array, a
+ bitset records which of them the program actually defines. Missing
+ parameters read as 0.
+ */
+
 class eTfSynthProgram
 {
 public:
     
-    typedef juce::HashMap<int,eF32> Parameters;
-    
     eTfSynthProgram();
     eTfSynthProgram(const eTfSynthProgram& copy) noexcept; // simple copy
     eTfSynthProgram& operator=(const eTfSynthProgram& copy); // copy assignemt
@@ -47,12 +52,31 @@ public:
     eF32     getParam(eU32 index) const;
     bool     hasParam(eU32 index) const;
     
+    // all TF_PARAM_COUNT values, missing ones are 0
+    const eF32 * getParams() const;
+    void     setParams(const eF32 *values);
+    
 	void     loadDefault(int i);
-    void     applyToSynth (eTfInstrument* inst);
-    void     loadFromSynth (eTfInstrument* inst);
+    bool     loadFromFile(const File &file);
+    String   toText() const;
+    void     applyToSynth (eTfParameterStore &store) const;
+    void     loadFromSynth (const eTfParameterStore &store);
+    
+    // index of the parameter stored under name in preset files, or -1
+    static int findParam(const String &name);
+    
+    // stable ID of a parameter in binary formats, a hash of its
+    // preset file name that survives changes to the enumeration
+    static eU32 paramId(eU32 index);
+    static int findParamById(eU32 id);
     
 private:
-    Parameters params;
+    static const eU32 PRESENT_WORDS = (TF_PARAM_COUNT + 31) / 32;
+
+    void     clear();
+
+    eF32       params[TF_PARAM_COUNT];
+    eU32       present[PRESENT_WORDS];
     String     name;
     
     JUCE_LEAK_DETECTOR (eTfSynthProgram);
@@ -0,0 +1,326 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#define eVSTI
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+#include "runtime/system.hpp"
+#include "tfworkerpool.hpp"
+
+// the same file the editor keeps its settings in
+static PropertiesFile::Options settingsOptions()
+{
+    PropertiesFile::Options options;
+    options.applicationName = JucePlugin_Name;
+    options.filenameSuffix = ".settings";
+    options.folderName = JucePlugin_Manufacturer;
+    options.osxLibrarySubFolder = "Application Support";
+    return options;
+}
+
+eTfWorkerPool::Batch::Batch() :
+    function (nullptr), context (nullptr), count (0), deadline (0), slot (-1), next (0), done (0)
+{
+}
+
+eTfWorkerPool::Semaphore::Semaphore()
+{
+#ifdef _WIN32
+    handle = CreateSemaphore (nullptr, 0, LONG_MAX, nullptr);
+#elif defined(__APPLE__)
+    handle = dispatch_semaphore_create (0);
+#else
+    sem_t *sem = new sem_t;
+    sem_init (sem, 0, 0);
+    handle = sem;
+#endif
+}
+
+eTfWorkerPool::Semaphore::~Semaphore()
+{
+#ifdef _WIN32
+    CloseHandle (handle);
+#elif defined(__APPLE__)
+    dispatch_release ((dispatch_semaphore_t)handle);
+#else
+    sem_destroy ((sem_t *)handle);
+    delete (sem_t *)handle;
+#endif
+}
+
+void eTfWorkerPool::Semaphore::signal()
+{
+#ifdef _WIN32
+    ReleaseSemaphore (handle, 1, nullptr);
+#elif defined(__APPLE__)
+    dispatch_semaphore_signal ((dispatch_semaphore_t)handle);
+#else
+    sem_post ((sem_t *)handle);
+#endif
+}
+
+void eTfWorkerPool::Semaphore::wait()
+{
+#ifdef _WIN32
+    WaitForSingleObject (handle, INFINITE);
+#elif defined(__APPLE__)
+    dispatch_semaphore_wait ((dispatch_semaphore_t)handle, DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait ((sem_t *)handle) != 0)
+        ; // interrupted by a signal
+#endif
+}
+
+eTfWorkerPool::eTfWorkerPool() : lateJobs (0), sleeping (0)
+{
+    for (int i=0; i<MAX_BATCHES; i++)
+    {
+        batches[i] = nullptr;
+        users[i] = 0;
+    }
+
+    PropertiesFile settings (settingsOptions());
+    const int numWorkers = jlimit (0, 64, settings.getIntValue ("WorkerThreads", jmax (1, SystemStats::getNumCpus() - 1)));
+    hostThreadsJoin = settings.getBoolValue ("HostThreadsJoinPool", false);
+
+    // JUCE 6 and later have a priority that asks the system for real-time
+    // audio scheduling. before that, 10 is the highest of the plain ones.
+#if JUCE_MAJOR_VERSION >= 6
+    const int priority = Thread::realtimeAudioPriority;
+#else
+    const int priority = 10;
+#endif
+
+    for (int i=0; i<numWorkers; i++)
+        workers.add (new Worker (*this))->startThread (priority);
+}
+
+eTfWorkerPool::~eTfWorkerPool()
+{
+    for (Worker *worker : workers)
+        worker->signalThreadShouldExit();
+
+    // sleeping workers wake up once each and see they should exit
+    for (int i=0; i<workers.size(); i++)
+        wakeup.signal();
+
+    for (Worker *worker : workers)
+        worker->stopThread (1000);
+}
+
+void eTfWorkerPool::submit (Batch &batch, JobFunction function, void *context, eU32 count, double deadline)
+{
+    eASSERT(batch.slot < 0);
+
+    batch.function = function;
+    batch.context = context;
+    batch.count = count;
+    batch.deadline = deadline;
+    batch.done.store (0, std::memory_order_relaxed);
+    batch.next.store (0, std::memory_order_relaxed);
+
+    if (count == 0)
+        return;
+
+    // without a free slot the submitter runs the batch alone in wait()
+    for (int i=0; i<MAX_BATCHES; i++)
+    {
+        Batch *expected = nullptr;
+        if (batches[i].compare_exchange_strong (expected, &batch))
+        {
+            batch.slot = i;
+            wake (count);
+            return;
+        }
+    }
+}
+
+void eTfWorkerPool::wait (Batch &batch)
+{
+    // the results are needed here, so this thread works on its own batch first
+    while (runJob (batch))
+        ;
+
+    // a worker preempted in the middle of a job can keep the batch open
+    // for longer than a spin is worth. past SPIN_COUNT the wait yields
+    // instead and is counted as late, it has likely missed the deadline.
+    int spins = 0;
+
+    while (batch.done.load (std::memory_order_acquire) < batch.count)
+    {
+        if (hostThreadsJoin && runDueJob())
+            continue;
+
+        if (++spins < SPIN_COUNT)
+        {
+            _mm_pause();
+            continue;
+        }
+
+        if (spins == SPIN_COUNT)
+            lateJobs.fetch_add (1, std::memory_order_relaxed);
+
+        Thread::yield();
+    }
+
+    if (batch.slot >= 0)
+    {
+        // workers may still be looking at the batch, it's
+        // only safe to reuse or free once they're gone
+        batches[batch.slot].store (nullptr);
+        while (users[batch.slot].load() != 0)
+            _mm_pause();
+
+        batch.slot = -1;
+    }
+}
+
+int eTfWorkerPool::getNumWorkers() const
+{
+    return workers.size();
+}
+
+int eTfWorkerPool::getNumLateJobs() const
+{
+    return lateJobs.load (std::memory_order_relaxed);
+}
+
+bool eTfWorkerPool::runJob (Batch &batch)
+{
+    const eU32 index = batch.next.fetch_add (1, std::memory_order_acq_rel);
+    if (index >= batch.count)
+        return false;
+
+    if (Time::getMillisecondCounterHiRes() > batch.deadline)
+        lateJobs.fetch_add (1, std::memory_order_relaxed);
+
+    batch.function (batch.context, index);
+    batch.done.fetch_add (1, std::memory_order_release);
+    return true;
+}
+
+// runs one job of the batch due first, of all instances
+bool eTfWorkerPool::runDueJob()
+{
+    int due = -1;
+    double dueTime = 0;
+
+    for (int i=0; i<MAX_BATCHES; i++)
+    {
+        if (batches[i].load (std::memory_order_relaxed) == nullptr)
+            continue;
+
+        users[i].fetch_add (1);
+        const Batch *batch = batches[i].load();
+
+        if (batch != nullptr && batch->next.load (std::memory_order_relaxed) < batch->count &&
+            (due < 0 || batch->deadline < dueTime))
+        {
+            due = i;
+            dueTime = batch->deadline;
+        }
+
+        users[i].fetch_sub (1);
+    }
+
+    if (due < 0)
+        return false;
+
+    users[due].fetch_add (1);
+    Batch *batch = batches[due].load();
+    const bool ran = batch != nullptr && runJob (*batch);
+    users[due].fetch_sub (1);
+
+    return ran;
+}
+
+// claims up to count of the sleeping workers and posts one wakeup
+// each. neither takes a lock, so this is safe on the audio thread.
+void eTfWorkerPool::wake (eU32 count)
+{
+    int asleep = sleeping.load();
+
+    while (count > 0 && asleep > 0)
+    {
+        if (sleeping.compare_exchange_weak (asleep, asleep - 1))
+        {
+            wakeup.signal();
+            count--;
+        }
+    }
+}
+
+void eTfWorkerPool::sleep()
+{
+    // a batch submitted after the count went up wakes a worker,
+    // one submitted before is found by the second look
+    sleeping.fetch_add (1);
+
+    if (!runDueJob())
+    {
+        wakeup.wait();
+        return;
+    }
+
+    // found work after all. if a submitter has claimed this worker
+    // already, its wakeup is left over and some worker's next sleep
+    // ends right away, which costs no more than another spin.
+    int asleep = sleeping.load();
+    while (asleep > 0 && !sleeping.compare_exchange_weak (asleep, asleep - 1))
+        ;
+}
+
+void eTfWorkerPool::Worker::run()
+{
+    int idle = 0;
+
+    while (!threadShouldExit())
+    {
+        if (pool.runDueJob())
+        {
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < SPIN_COUNT)
+        {
+            _mm_pause();
+            continue;
+        }
+
+        pool.sleep();
+        idle = 0;
+    }
+}
@@ -0,0 +1,139 @@
+/*********************************************************************
+ 
+ Sprike
+ https://github.com/cognitone/sprike
+ 
+ Tunefish4
+ http://tunefish-synth.com
+ 
+ This file is part of Sprike, Cognitone (2017)
+ An extended version of Tunefish4, Brain Control (2014)
+ 
+ Sprike is free software: you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ Sprike is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Sprike. If not, see <http://www.gnu.org/licenses/>.
+ 
+ *********************************************************************/
+
+#ifndef TF_WORKERPOOL_HPP
+#define TF_WORKERPOOL_HPP
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "runtime/system.hpp"
+
+
+/**
+ Real-time worker threads shared by all plugin instances in the process,
+ so sixty instances on sixteen cores don't start sixty sets of threads.
+ Hold it through a SharedResourcePointer, the threads go away with the
+ last instance.
+
+ Work comes in batches of independent jobs, such as one job per part.
+ The submitting thread runs its batch's remaining jobs itself in wait(),
+ so nothing stalls even without a single worker. Workers take jobs from
+ any instance's batch, the batch due first before the others. Idle
+ workers spin for a moment before they go to sleep on a semaphore,
+ which submit() posts to without taking a lock.
+
+ The number of workers and whether host audio threads help with other
+ instances' jobs while waiting are read from the settings file.
+ */
+
+class eTfWorkerPool
+{
+public:
+    typedef void (*JobFunction) (void *context, eU32 index);
+
+    // Owned and reused by the submitter. A batch must
+    // be waited for before it is submitted again.
+    class Batch
+    {
+    public:
+        Batch();
+
+    private:
+        friend class eTfWorkerPool;
+
+        JobFunction             function;
+        void *                  context;
+        eU32                    count;
+        double                  deadline;
+        int                     slot;
+        std::atomic<eU32>       next;
+        std::atomic<eU32>       done;
+    };
+
+     eTfWorkerPool();
+    ~eTfWorkerPool();
+
+    // Runs function(context, 0..count-1) on the pool. The jobs should be
+    // done by deadline, in Time::getMillisecondCounterHiRes() terms.
+    void submit (Batch &batch, JobFunction function, void *context, eU32 count, double deadline);
+
+    // Returns once all jobs of the batch are done. Spins while the last
+    // jobs finish on workers, then yields the CPU if they take too long.
+    void wait (Batch &batch);
+
+    int getNumWorkers() const;
+
+    // jobs that started after their deadline and waits that
+    // spun out before their batch was done, for diagnostics
+    int getNumLateJobs() const;
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker (eTfWorkerPool &p) : Thread ("Sprike Worker"), pool (p) {}
+
+        void run() override;
+
+        eTfWorkerPool &         pool;
+    };
+
+    // Counting semaphore on the system's own. Unlike Thread::notify()
+    // signal() takes no mutex, so the audio thread may call it.
+    class Semaphore
+    {
+    public:
+         Semaphore();
+        ~Semaphore();
+
+        void signal();
+        void wait();
+
+    private:
+        void *                  handle;
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    bool runJob (Batch &batch);
+    bool runDueJob();
+    void wake (eU32 count);
+    void sleep();
+
+    static const int        MAX_BATCHES = 64;
+    static const int        SPIN_COUNT = 2000;
+
+    std::atomic<Batch *>    batches[MAX_BATCHES];
+    std::atomic<int>        users[MAX_BATCHES];
+    std::atomic<int>        lateJobs;
+    std::atomic<int>        sleeping;   // workers going to sleep, not yet woken
+    Semaphore               wakeup;
+    bool                    hostThreadsJoin;
+    OwnedArray<Worker>      workers;
+
+    JUCE_DECLARE_NON_COPYABLE (eTfWorkerPool)
+};
+
+#endif